@@ -1,6 +1,5 @@
 #include "src/chess_engine.hpp"
-
-String inbuf;
+#include "src/arena.hpp"
 
 void setup(){
 #ifdef ARDUINO_ENV
@@ -8,20 +7,11 @@ void setup(){
   while(!Serial){}
 #endif
   initEngine();
+  reportMemory();
 }
 
 void loop(){
 #ifdef ARDUINO_ENV
-  while(Serial.available()){
-    char c=Serial.read(); if(c=='\r') continue;
-    if(c=='\n'){
-      String cmd=inbuf; inbuf=""; cmd.trim();
-      if(cmd=="uci"){ Serial.println("id name PicoChess Bitboard"); Serial.println("id author Arnold"); Serial.println("uciok"); }
-      else if(cmd=="isready"){ Serial.println("readyok"); }
-      else if(cmd=="ucinewgame"){ setStartPos(); }
-      else if(cmd.startsWith("position")){ parsePosition(cmd); }
-      else if(cmd.startsWith("go")){ goCommand(cmd); }
-    } else inbuf+=c;
-  }
+  while(Serial.available()) protocolInput((uint8_t)Serial.read());
 #endif
 }
@@ -0,0 +1,36 @@
+#include "arena.hpp"
+#include <cstdio>
+
+Arena arena;
+Move *moveTop = arena.moveStack;
+uintptr_t stackBase;
+uint32_t stackPeak;
+int stackPeakPly;
+
+// Boot-time RAM report, one "info string" line per topic. It measures the
+// search stack with a short search, so it runs before the first position.
+void reportMemory(){
+  char buf[128];
+  unsigned long io = sizeof(arena.inputLine) + sizeof(arena.frame);
+  unsigned long pv = sizeof(arena.pvTable) + sizeof(arena.pvLength);
+  snprintf(buf,sizeof(buf),"info string ram tt %lu history %lu movestack %lu pv %lu io %lu total %lu of %lu",
+           (unsigned long)sizeof(arena.tt),(unsigned long)sizeof(arena.history),
+           (unsigned long)sizeof(arena.moveStack),pv,io,(unsigned long)sizeof(Arena),(unsigned long)ARENA_BYTES);
+  sendLine(buf);
+  unsigned long zobrist = sizeof(pieceKeys) + sizeof(castleKeys) + sizeof(epKeys);
+  unsigned long attacks = sizeof(pawnAttacks) + sizeof(knightAttacks) + sizeof(kingAttacks);
+  snprintf(buf,sizeof(buf),"info string ram outside arena: zobrist %lu attacks %lu search stack %lu",
+           zobrist,attacks,(unsigned long)SEARCH_STACK_BYTES);
+  sendLine(buf);
+  // Below the root every ply reserves MAX_MOVES on the move stack and one
+  // frame on the C stack. Whichever runs out first bounds the depth that is
+  // always searched full width; deeper nodes are evaluated statically.
+  int frame = searchFrameBytes();
+  int movePlies = MOVE_STACK_MOVES/MAX_MOVES - 1;
+  int stackPlies = SEARCH_STACK_BYTES/frame;
+  int safe = movePlies < stackPlies ? movePlies : stackPlies;
+  if(safe > MAX_PLY) safe = MAX_PLY;
+  snprintf(buf,sizeof(buf),"info string safe depth %d: move stack %d plies, search stack %d plies of %d bytes, ply limit %d",
+           safe,movePlies,stackPlies,frame,MAX_PLY);
+  sendLine(buf);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "chess_engine.hpp"
+
+// All large engine state lives in one statically allocated arena, so RAM
+// use is fixed at link time and checked against ARENA_BYTES here.
+
+#ifndef ARENA_BYTES
+#define ARENA_BYTES (64*1024)
+#endif
+
+// Shared stack for the move lists of every ply (8 bytes per move).
+#ifndef MOVE_STACK_MOVES
+#define MOVE_STACK_MOVES 3072
+#endif
+
+#define INPUT_LINE_MAX 1024
+
+// C stack the search may use below its root. A node deeper than this is
+// evaluated statically, as when the move stack runs out.
+#ifndef SEARCH_STACK_BYTES
+#define SEARCH_STACK_BYTES 4096
+#endif
+
+struct Arena {
+  TTEntry tt[TT_ENTRIES];
+  History history[MAX_PLY];
+  Move moveStack[MOVE_STACK_MOVES];
+  uint16_t pvTable[MAX_DEPTH][MAX_DEPTH];   // triangular PV, see search()
+  uint8_t pvLength[MAX_DEPTH+1];
+  char inputLine[INPUT_LINE_MAX+1];
+  uint8_t frame[FRAME_MAX_PAYLOAD+1];
+};
+
+static_assert(sizeof(Arena) <= ARENA_BYTES, "engine arena exceeds ARENA_BYTES");
+static_assert(MOVE_STACK_MOVES >= 2*MAX_MOVES, "move stack must hold the root list and one ply");
+
+extern Arena arena;
+extern Move *moveTop;
+extern uintptr_t stackBase;
+extern uint32_t stackPeak;
+extern int stackPeakPly;
+
+// Ply lists are carved from arena.moveStack; a node that cannot reserve
+// MAX_MOVES more entries is evaluated statically instead of expanded.
+inline bool moveStackFull(){ return moveTop + MAX_MOVES > arena.moveStack + MOVE_STACK_MOVES; }
+
+// Marks the caller's frame as the root for searchStackFull().
+inline void markSearchStack(){ char here; stackBase=(uintptr_t)&here; stackPeak=0; stackPeakPly=0; }
+
+// True once the search has used SEARCH_STACK_BYTES below its root. Records
+// the deepest use and its ply for the memory report.
+inline bool searchStackFull(int ply){
+  char here;
+  uint32_t used = stackBase - (uintptr_t)&here;
+  if(used > stackPeak){ stackPeak=used; stackPeakPly=ply; }
+  return used > SEARCH_STACK_BYTES;
+}
+
+// Generates the moves of the current position on top of the move stack and
+// releases them again when it goes out of scope.
+struct PlyMoves {
+  Move *moves;
+  int count;
+  PlyMoves(): moves(moveTop) { count = generateMoves(moves); moveTop += count; }
+  ~PlyMoves(){ moveTop = moves; }
+};
+
+void reportMemory();
@@ -6,6 +6,12 @@ int side = WHITE;
 int castle = 0;
 int enpassant = -1;
 int halfmove = 0, fullmove = 1;
+U64 hashKey = 0ULL;
+
+U64 pieceKeys[12][64];
+U64 castleKeys[16];
+U64 epKeys[8];
+U64 sideKey;
 
 U64 pawnAttacks[2][64];
 U64 knightAttacks[64];
@@ -48,6 +54,28 @@ void initLeapers(){
   }
 }
 
+static U64 nextRandom(){
+  static U64 state = 0x9E3779B97F4A7C15ULL;
+  state ^= state >> 12; state ^= state << 25; state ^= state >> 27;
+  return state * 0x2545F4914F6CDD1DULL;
+}
+
+void initHashKeys(){
+  for(int p=WP; p<=BK; p++) for(int sq=0; sq<64; sq++) pieceKeys[p][sq] = nextRandom();
+  for(int i=0; i<16; i++) castleKeys[i] = nextRandom();
+  for(int f=0; f<8; f++) epKeys[f] = nextRandom();
+  sideKey = nextRandom();
+}
+
+U64 computeHash(){
+  U64 h = 0ULL;
+  for(int p=WP; p<=BK; p++){ U64 bb = bitboards[p]; while(bb) h ^= pieceKeys[p][popLSB(bb)]; }
+  h ^= castleKeys[castle];
+  if(enpassant!=-1) h ^= epKeys[enpassant%8];
+  if(side==BLACK) h ^= sideKey;
+  return h;
+}
+
 U64 maskRookAttacks(int sq, U64 block){
   U64 attacks=0ULL; int r=sq/8, f=sq%8;
   for(int tr=r+1; tr<=7; tr++){ int s=tr*8+f; attacks|=1ULL<<s; if(getBit(block,s)) break; }
@@ -97,29 +125,37 @@ bool squareAttacked(int sq, int bySide){
 
 void clearBoard(){ for(int i=0;i<12;i++) bitboards[i]=0ULL; castle=0; enpassant=-1; }
 
-bool loadFEN(const String &fen){
+// Reads placement, side, castling and en passant; anything after that
+// (clocks, " moves ...") is left alone, so fen may point into a longer line.
+bool loadFEN(const char *fen){
   clearBoard();
-  int i=0, sq=56;
-  while(i<fen.length() && fen[i]!=' '){
-    char c=fen[i++];
+  const char *p=fen;
+  int sq=56;
+  while(*p && *p!=' '){
+    char c=*p++;
     if(c=='/') sq-=16; else if(c>='1'&&c<='8') sq+=c-'0'; else {
-      Piece p=NO_PIECE;
+      Piece pc=NO_PIECE;
       switch(c){
-        case 'P': p=WP; break; case 'N': p=WN; break; case 'B': p=WB; break; case 'R': p=WR; break; case 'Q': p=WQ; break; case 'K': p=WK; break;
-        case 'p': p=BP; break; case 'n': p=BN; break; case 'b': p=BB; break; case 'r': p=BR; break; case 'q': p=BQ; break; case 'k': p=BK; break;
+        case 'P': pc=WP; break; case 'N': pc=WN; break; case 'B': pc=WB; break; case 'R': pc=WR; break; case 'Q': pc=WQ; break; case 'K': pc=WK; break;
+        case 'p': pc=BP; break; case 'n': pc=BN; break; case 'b': pc=BB; break; case 'r': pc=BR; break; case 'q': pc=BQ; break; case 'k': pc=BK; break;
       }
-      if(p!=NO_PIECE){ setBit(bitboards[p], sq); sq++; }
+      if(pc!=NO_PIECE && sq>=0 && sq<64){ setBit(bitboards[pc], sq); sq++; }
     }
   }
-  if(i>=fen.length()) return false; i++;
-  side = (fen[i]=='w') ? WHITE : BLACK;
-  while(i<fen.length() && fen[i]!=' ') i++; i++;
-  if(fen[i]=='-') i++; else {
-    while(i<fen.length() && fen[i]!=' '){ char c=fen[i++]; if(c=='K') castle|=WKC; if(c=='Q') castle|=WQC; if(c=='k') castle|=BKC; if(c=='q') castle|=BQC; }
+  if(!*p) return false;
+  p++;
+  side = (*p=='w') ? WHITE : BLACK;
+  while(*p && *p!=' ') p++;
+  while(*p==' ') p++;
+  if(*p=='-') p++;
+  else {
+    while(*p && *p!=' '){ char c=*p++; if(c=='K') castle|=WKC; if(c=='Q') castle|=WQC; if(c=='k') castle|=BKC; if(c=='q') castle|=BQC; }
   }
-  while(i<fen.length() && fen[i]==' ') i++;
-  if(fen[i]=='-'){ enpassant=-1; i++; } else { int f=fen[i]-'a', r=fen[i+1]-'1'; enpassant=r*8+f; i+=2; }
+  while(*p==' ') p++;
+  if(*p>='a' && *p<='h' && p[1]>='1' && p[1]<='8') enpassant=(p[1]-'1')*8+(p[0]-'a');
+  else enpassant=-1;
   updateOccupancies();
+  hashKey = computeHash();
   return true;
 }
 
@@ -20,6 +20,12 @@ extern int side;
 extern int castle;
 extern int enpassant;
 extern int halfmove, fullmove;
+extern U64 hashKey;
+
+extern U64 pieceKeys[12][64];
+extern U64 castleKeys[16];
+extern U64 epKeys[8];
+extern U64 sideKey;
 
 extern U64 pawnAttacks[2][64];
 extern U64 knightAttacks[64];
@@ -33,6 +39,8 @@ int popLSB(U64 &bb);
 int countBits(U64 bb);
 
 void initLeapers();
+void initHashKeys();
+U64 computeHash();
 U64 maskRookAttacks(int sq, U64 block);
 U64 maskBishopAttacks(int sq, U64 block);
 void updateOccupancies();
@@ -40,5 +48,5 @@ int pieceAt(int sq);
 bool squareAttacked(int sq, int bySide);
 
 void clearBoard();
-bool loadFEN(const String &fen);
+bool loadFEN(const char *fen);
 void setStartPos();
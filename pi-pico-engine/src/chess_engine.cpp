@@ -1,13 +1,27 @@
 #include "chess_engine.hpp"
+#include "arena.hpp"
+#include <cstdio>
+#include <cstring>
 
-History history[128];
 int histPly=0;
+bool positionValid=true;   // false after a position command that could not be set up
 
 unsigned long stopTime;
 bool stopSearch=false;
+unsigned long nodes=0;
+unsigned long nodeLimit=0;
+int rootPly=0;
+
+int multiPV=1;
+uint16_t searchMoves[MAX_SEARCHMOVES];
+int searchMoveCount=0;
 
 inline bool timeCheck(){
   if(stopSearch) return true;
+  if(nodeLimit && nodes >= nodeLimit){
+    stopSearch = true;
+    return true;
+  }
   if(platformMillis() >= stopTime){
     stopSearch = true;
     return true;
@@ -16,16 +30,21 @@ inline bool timeCheck(){
 }
 
 bool makeMove(const Move &m){
-  History &h = history[histPly];
-  h.m = m; h.castle = castle; h.ep = enpassant; h.half = halfmove;
+  History &h = arena.history[histPly];
+  h.m = m; h.castle = castle; h.ep = enpassant; h.half = halfmove; h.hash = hashKey;
 
   popBit(bitboards[m.piece], m.from);
+  hashKey ^= pieceKeys[m.piece][m.from];
   if(m.flags & 4){
     int capSq = (side==WHITE ? m.to-8 : m.to+8);
     int capPiece = side==WHITE ? BP : WP;
     popBit(bitboards[capPiece], capSq);
+    hashKey ^= pieceKeys[capPiece][capSq];
+  }
+  if(m.capture!=NO_PIECE && !(m.flags & 4)){
+    popBit(bitboards[m.capture], m.to);
+    hashKey ^= pieceKeys[m.capture][m.to];
   }
-  if(m.capture!=NO_PIECE && !(m.flags & 4)) popBit(bitboards[m.capture], m.to);
 
   int piece = m.piece;
   int to = m.to;
@@ -33,43 +52,57 @@ bool makeMove(const Move &m){
     piece = (side==WHITE ? WQ : BQ);
   }
   setBit(bitboards[piece], to);
+  hashKey ^= pieceKeys[piece][to];
 
   if(m.flags & 8){
-    if(m.to==6){ popBit(bitboards[WR],7); setBit(bitboards[WR],5); }
-    else if(m.to==2){ popBit(bitboards[WR],0); setBit(bitboards[WR],3); }
-    else if(m.to==62){ popBit(bitboards[BR],63); setBit(bitboards[BR],61); }
-    else if(m.to==58){ popBit(bitboards[BR],56); setBit(bitboards[BR],59); }
+    int rook = side==WHITE ? WR : BR, rf = -1, rt = -1;
+    if(m.to==6){ rf=7; rt=5; }
+    else if(m.to==2){ rf=0; rt=3; }
+    else if(m.to==62){ rf=63; rt=61; }
+    else if(m.to==58){ rf=56; rt=59; }
+    if(rf>=0){
+      popBit(bitboards[rook],rf); setBit(bitboards[rook],rt);
+      hashKey ^= pieceKeys[rook][rf] ^ pieceKeys[rook][rt];
+    }
   }
 
+  hashKey ^= castleKeys[castle];
+
   if(m.piece==WK) castle &= ~(WKC|WQC);
   if(m.piece==BK) castle &= ~(BKC|BQC);
   if(m.from==0 || m.to==0) castle &= ~WQC;
   if(m.from==7 || m.to==7) castle &= ~WKC;
   if(m.from==56 || m.to==56) castle &= ~BQC;
   if(m.from==63 || m.to==63) castle &= ~BKC;
+  hashKey ^= castleKeys[castle];
 
+  if(enpassant!=-1) hashKey ^= epKeys[enpassant%8];
   enpassant = -1;
-  if(m.flags & 2) enpassant = (side==WHITE ? m.from+8 : m.from-8);
+  if(m.flags & 2){
+    enpassant = (side==WHITE ? m.from+8 : m.from-8);
+    hashKey ^= epKeys[enpassant%8];
+  }
 
   updateOccupancies();
 
-  int kingSq = lsb(bitboards[ side==WHITE ? WK : BK ]);
-  if(squareAttacked(kingSq, side^1)){
+  side ^= 1;
+  hashKey ^= sideKey;
+  histPly++;
+
+  int kingSq = lsb(bitboards[ side==WHITE ? BK : WK ]);
+  if(squareAttacked(kingSq, side)){
     unmakeMove();
     return false;
   }
-
-  side ^= 1;
-  histPly++;
   return true;
 }
 
 void unmakeMove(){
   histPly--;
   side ^= 1;
-  History &h = history[histPly];
+  History &h = arena.history[histPly];
   const Move &m = h.m;
-  castle = h.castle; enpassant = h.ep; halfmove = h.half;
+  castle = h.castle; enpassant = h.ep; halfmove = h.half; hashKey = h.hash;
 
   popBit(bitboards[m.flags & 16 ? (side==WHITE?WQ:BQ):m.piece], m.to);
   setBit(bitboards[m.piece], m.from);
@@ -93,12 +126,14 @@ void unmakeMove(){
 }
 
 int quiesce(int alpha,int beta){
+  nodes++;
   if(timeCheck()) return alpha;
   int stand = evaluate();
   if(stand >= beta) return beta;
   if(stand > alpha) alpha = stand;
+  if(histPly >= MAX_PLY || moveStackFull() || searchStackFull(histPly-rootPly)) return alpha;
 
-  MoveList list; generateMoves(list);
+  PlyMoves list;
   for(int i=0;i<list.count;i++){
     if(!(list.moves[i].flags & 1)) continue;
     if(!makeMove(list.moves[i])) continue;
@@ -111,124 +146,276 @@ int quiesce(int alpha,int beta){
   return alpha;
 }
 
+static void updatePV(int ply,const Move& m){
+  if(ply>=MAX_DEPTH) return;
+  arena.pvTable[ply][0]=encodeMove(m);
+  int n = ply+1<MAX_DEPTH ? arena.pvLength[ply+1] : 0;
+  if(n>MAX_DEPTH-1) n=MAX_DEPTH-1;
+  for(int i=0;i<n;i++) arena.pvTable[ply][i+1]=arena.pvTable[ply+1][i];
+  arena.pvLength[ply]=n+1;
+}
+
+bool inCheck(){
+  return squareAttacked(lsb(bitboards[ side==WHITE?WK:BK ]), side^1);
+}
+
+// Triangular PV: arena.pvTable[ply] holds the best line found below ply, as
+// move codes. An exact table score inside the window is searched again
+// rather than returned, so every PV node fills its part of it.
 int search(int depth,int alpha,int beta){
-  if(timeCheck()) return alpha;
+  int ply = histPly - rootPly;
+  if(ply<=MAX_DEPTH) arena.pvLength[ply]=0;
   if(depth==0) return quiesce(alpha,beta);
-  MoveList list; generateMoves(list);
-  if(list.count==0){
-    if(squareAttacked(lsb(bitboards[ side==WHITE?WK:BK ]), side^1)) return -32000 + depth;
-    return 0;
+  nodes++;
+  if(timeCheck()) return alpha;
+  if(histPly >= MAX_PLY || moveStackFull() || searchStackFull(ply)) return evaluate();
+  TTEntry* tt = probeTT(hashKey);
+  if(tt && tt->depth>=depth){
+    int sc = ttScore(*tt, ply);
+    if(tt->flag!=TT_UPPER && sc>=beta) return beta;
+    if(tt->flag!=TT_LOWER && sc<=alpha) return alpha;
+  }
+  PlyMoves list;
+  if(tt){
+    for(int i=1;i<list.count;i++){
+      if(list.moves[i].from==tt->from && list.moves[i].to==tt->to){
+        Move t=list.moves[0]; list.moves[0]=list.moves[i]; list.moves[i]=t; break;
+      }
+    }
   }
+  int oldAlpha = alpha, legal = 0;
+  Move best = {0};
   for(int i=0;i<list.count;i++){
     Move m = list.moves[i];
     if(!makeMove(m)) continue;
+    legal++;
     int score = -search(depth-1, -beta, -alpha);
     unmakeMove();
     if(stopSearch) return alpha;
-    if(score >= beta) return beta;
-    if(score > alpha) alpha = score;
+    if(score >= beta){ storeTT(hashKey, depth, beta, TT_LOWER, m, ply); return beta; }
+    if(score > alpha){ alpha = score; best = m; updatePV(ply,m); }
   }
+  if(!legal) return inCheck() ? -MATE_SCORE + ply : 0;
+  storeTT(hashKey, depth, alpha, alpha>oldAlpha ? TT_EXACT : TT_UPPER, best, ply);
   return alpha;
 }
 
-Move thinkDepth(int depth){
+static bool rootMoveAllowed(const Move& m){
+  if(!searchMoveCount) return true;
+  uint16_t key = m.from | (m.to<<6);
+  for(int i=0;i<searchMoveCount;i++) if(searchMoves[i]==key) return true;
+  return false;
+}
+
+// Reports line k from the triangular PV left by the root search.
+static void reportLine(int depth,int k,int score,unsigned long start){
+  SearchInfo info;
+  info.depth=depth; info.multipv=k;
+  info.mate = score > MATE_BOUND || score < -MATE_BOUND;
+  if(score > MATE_BOUND) info.score=(MATE_SCORE-score+1)/2;
+  else if(score < -MATE_BOUND) info.score=-(MATE_SCORE+score)/2;
+  else info.score=score;
+  info.nodes=nodes; info.time=platformMillis()-start;
+  info.pvLen = arena.pvLength[0] < MAX_PV ? arena.pvLength[0] : MAX_PV;
+  for(int i=0;i<info.pvLen;i++) info.pv[i]=arena.pvTable[0][i];
+  sendInfo(info);
+}
+
+// Iterative deepening with MultiPV by root exclusion: line k searches only
+// the root moves not already chosen for lines 1..k-1, and every line shares
+// the transposition table, so later lines are mostly table hits.
+static Move think(int maxDepth){
   stopSearch=false;
-  stopTime = platformMillis() + 1000000UL;
-  Move best={0};
-  int bestScore=-32000;
-  MoveList list; generateMoves(list);
-  for(int d=1; d<=depth && !stopSearch; d++){
-    for(int i=0;i<list.count && !stopSearch;i++){
-      Move m = list.moves[i];
-      if(!makeMove(m)) continue;
-      int sc = -search(d-1, -32000, 32000);
-      unmakeMove();
+  nodes=0;
+  rootPly=histPly;
+  markSearchStack();
+  ttAge++;
+  unsigned long start=platformMillis();
+  PlyMoves list;
+  int count=0;
+  for(int i=0;i<list.count;i++){
+    if(!rootMoveAllowed(list.moves[i]) || !makeMove(list.moves[i])) continue;
+    unmakeMove();
+    list.moves[count++]=list.moves[i];
+  }
+  if(count==0) return Move{0};   // mate, stalemate or no legal searchmoves: null move
+  Move best=list.moves[0];
+  int lines = multiPV<count ? multiPV : count;
+  for(int d=1; d<=maxDepth && !stopSearch; d++){
+    for(int k=0;k<lines && !stopSearch;k++){
+      int alpha=-MATE_SCORE, bestIdx=-1;
+      for(int i=k;i<count;i++){
+        if(!makeMove(list.moves[i])) continue;
+        int sc = -search(d-1, -MATE_SCORE, -alpha);
+        unmakeMove();
+        if(stopSearch) break;
+        if(sc>alpha || bestIdx<0){ alpha=sc; bestIdx=i; updatePV(0,list.moves[i]); }
+      }
+      if(bestIdx<0) break;
+      Move t=list.moves[k]; list.moves[k]=list.moves[bestIdx]; list.moves[bestIdx]=t;
+      if(k==0) best=list.moves[0];
       if(stopSearch) break;
-      if(sc>bestScore){ bestScore=sc; best=m; }
+      list.moves[k].score=alpha;
+      reportLine(d,k+1,alpha,start);
     }
   }
-  if(best.from==0 && best.to==0 && list.count>0) best=list.moves[0];
   return best;
 }
 
+Move thinkDepth(int depth){
+  stopTime = platformMillis() + 1000000UL;
+  return think(depth);
+}
+
 Move thinkTime(int milliseconds){
-  stopSearch=false;
   stopTime = platformMillis() + milliseconds;
-  MoveList list; generateMoves(list);
-  Move best = list.count>0 ? list.moves[0] : Move{0};
-  int bestScore=-32000;
-  for(int d=1; !stopSearch; d++){
-    for(int i=0;i<list.count && !stopSearch;i++){
-      Move m = list.moves[i];
-      if(!makeMove(m)) continue;
-      int sc = -search(d-1, -32000, 32000);
-      unmakeMove();
-      if(stopSearch) break;
-      if(sc>bestScore){ bestScore=sc; best=m; }
-    }
-  }
-  return best;
+  return think(MAX_DEPTH);
 }
 
-void parsePosition(const String& s){
-  if(s.indexOf("startpos")>=0) setStartPos();
-  else {
-    int p=s.indexOf("fen ");
-    if(p>=0){ String fen=s.substring(p+4); int mpos=fen.indexOf(" moves "); if(mpos>=0) fen=fen.substring(0,mpos); const_cast<String&>(fen).trim(); loadFEN(fen); }
-  }
-  int m=s.indexOf(" moves ");
-  if(m>=0){
-    String rest=s.substring(m+7); const_cast<String&>(rest).trim(); int i=0;
-    while(i<rest.length()){
-      char f1=rest[i++]; char r1=rest[i++]; char f2=rest[i++]; char r2=rest[i++];
-      int from=(r1-'1')*8+(f1-'a'); int to=(r2-'1')*8+(f2-'a');
-      MoveList list; generateMoves(list);
-      for(int j=0;j<list.count;j++){ Move mv=list.moves[j]; if(mv.from==from && mv.to==to){ makeMove(mv); break; } }
-      if(i<rest.length() && rest[i]=='q') i++;
-      while(i<rest.length() && rest[i]==' ') i++;
-    }
+// Stack bytes per search ply, measured with a short search of the current
+// position since the frame size is up to the compiler. Clears the table.
+int searchFrameBytes(){
+  stopSearch=false; nodeLimit=0; nodes=0;
+  stopTime = platformMillis() + 1000000UL;
+  rootPly=histPly;
+  markSearchStack();
+  search(3,-MATE_SCORE,MATE_SCORE);
+  clearTT();
+  return (stackPeak + stackPeakPly) / (stackPeakPly + 1);
+}
+
+// Plays a move while setting up a position and keeps the move clocks. The
+// game history before the root is never unmade, so histPly is rewound to
+// keep history[] free.
+bool playMove(int from,int to){
+  PlyMoves list;
+  for(int j=0;j<list.count;j++){
+    Move mv=list.moves[j];
+    if(mv.from!=from || mv.to!=to) continue;
+    if(!makeMove(mv)) return false;
+    halfmove = (mv.piece==WP || mv.piece==BP || mv.capture!=NO_PIECE) ? 0 : halfmove+1;
+    if(side==WHITE) fullmove++;
+    histPly=0;
+    return true;
   }
+  return false;
 }
 
-int extractInt(const String& s,const String& key){
-  int p=s.indexOf(key+" ");
-  if(p<0) return -1;
-  int start=p+key.length()+1;
-  String tail=s.substring(start);
-  int space=tail.indexOf(" ");
-  int end=(space<0)?s.length():start+space;
-  return s.substring(start,end).toInt();
+// Applies one token of the moves list; false if it is not a coordinate
+// move, or if the move is illegal, which also invalidates the position.
+bool positionMove(const Token &t){
+  int from, to;
+  if(!tokenMove(t,from,to)) return false;
+  if(playMove(from,to)) return true;
+  positionValid=false;
+  return false;
 }
 
-int computeMoveTime(const String& s){
-  int mtg=extractInt(s,"movestogo");
-  int wtime=extractInt(s,"wtime");
-  int btime=extractInt(s,"btime");
-  int available = side==WHITE ? wtime : btime;
+void parsePosition(const char *line){
+  Tokenizer tk(line); Token t;
+  tk.next(t);
+  positionValid=false;
+  if(!tk.next(t)) return;
+  histPly=0;
+  if(tokenIs(t,"startpos")) setStartPos();
+  else if(tokenIs(t,"fen")){ if(!loadFEN(tk.rest())) return; }
+  else return;
+  positionValid=true;
+  while(tk.next(t) && !tokenIs(t,"moves")) {}
+  while(tk.next(t) && positionMove(t)) {}
+}
+
+int computeMoveTime(const GoParams& g){
+  if(g.movetime>0) return g.movetime;
+  int available = side==WHITE ? g.wtime : g.btime;
   if(available<=0) return 1000;
-  if(mtg>0) available /= mtg;
+  if(g.movestogo>0) available /= g.movestogo;
   else available /= 30;
   if(available<10) available=10;
   return available;
 }
 
-void sendBestMove(const Move& bm){
-  char buf[6];
-  int f1=bm.from%8, r1=bm.from/8, f2=bm.to%8, r2=bm.to/8;
-  buf[0]='a'+f1; buf[1]='1'+r1; buf[2]='a'+f2; buf[3]='1'+r2;
-  if(bm.flags & 16){ buf[4]='q'; buf[5]=0; } else buf[4]=0;
-  Serial.print("bestmove "); Serial.println(buf);
-}
-
-void goCommand(const String& s){
-  int d=extractInt(s,"depth");
+void runGo(const GoParams& g){
+  if(!positionValid){
+    searchMoveCount=0;
+    sendLine("info string no valid position, send position first");
+    sendBestMove(Move{0});
+    return;
+  }
+  nodeLimit = g.nodes>0 ? g.nodes : 0;
   Move bm;
-  if(d>0) bm=thinkDepth(d);
-  else bm=thinkTime(computeMoveTime(s));
+  if(g.depth>0) bm=thinkDepth(g.depth);
+  else if(g.nodes>0) bm=thinkDepth(MAX_DEPTH);
+  else bm=thinkTime(computeMoveTime(g));
+  nodeLimit=0;
+  searchMoveCount=0;
   sendBestMove(bm);
 }
 
+void goCommand(const char *line){
+  GoParams g={0,0,0,0,0,0,0,0};
+  Tokenizer tk(line); Token t;
+  tk.next(t);
+  searchMoveCount=0;
+  while(tk.next(t)){
+    if(tokenIs(t,"searchmoves")){
+      int from, to;
+      const char *mark=tk.p;
+      while(tk.next(t) && tokenMove(t,from,to)){
+        if(searchMoveCount<MAX_SEARCHMOVES) searchMoves[searchMoveCount++] = from | (to<<6);
+        mark=tk.p;
+      }
+      tk.p=mark;
+      continue;
+    }
+    int *field = tokenIs(t,"wtime") ? &g.wtime : tokenIs(t,"btime") ? &g.btime :
+                 tokenIs(t,"winc") ? &g.winc : tokenIs(t,"binc") ? &g.binc :
+                 tokenIs(t,"movetime") ? &g.movetime : tokenIs(t,"nodes") ? &g.nodes :
+                 tokenIs(t,"movestogo") ? &g.movestogo : tokenIs(t,"depth") ? &g.depth : nullptr;
+    if(field && tk.next(t)) *field=tokenInt(t);
+  }
+  runGo(g);
+}
+
+void setOption(const char *line){
+  Tokenizer tk(line); Token t, name={"",0}, value={"",0};
+  tk.next(t);
+  while(tk.next(t)){
+    if(tokenIs(t,"name")) tk.next(name);
+    else if(tokenIs(t,"value")) tk.next(value);
+  }
+  if(tokenIs(name,"MultiPV")){
+    int v=tokenInt(value);
+    multiPV = v<1 ? 1 : (v>MAX_MULTIPV ? MAX_MULTIPV : v);
+  }
+  else if(tokenIs(name,"BinaryFrames")){
+    binaryMode = tokenIs(value,"true");
+  }
+}
+
+void uciCommand(const char *line){
+  Tokenizer tk(line); Token cmd;
+  if(!tk.next(cmd)) return;
+  if(tokenIs(cmd,"uci")){
+    binaryMode=false;
+    sendLine("id name PicoChess Bitboard"); sendLine("id author Arnold");
+    char buf[64];
+    snprintf(buf,sizeof(buf),"option name MultiPV type spin default 1 min 1 max %d",MAX_MULTIPV);
+    sendLine(buf);
+    sendLine("option name BinaryFrames type check default false");
+    sendLine("uciok");
+  }
+  else if(tokenIs(cmd,"isready")){ sendLine("readyok"); }
+  else if(tokenIs(cmd,"quit")){ quitRequested=true; }
+  else if(tokenIs(cmd,"ucinewgame")){ clearTT(); setStartPos(); positionValid=true; }
+  else if(tokenIs(cmd,"setoption")){ setOption(line); }
+  else if(tokenIs(cmd,"position")){ parsePosition(line); }
+  else if(tokenIs(cmd,"go")){ goCommand(line); }
+}
+
 void initEngine(){
   initLeapers();
+  initHashKeys();
+  clearTT();
   setStartPos();
 }
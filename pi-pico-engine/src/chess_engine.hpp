@@ -2,21 +2,46 @@
 
 #include "move_generator.hpp"
 #include "evaluation.hpp"
+#include "transposition.hpp"
+#include "protocol.hpp"
+#include "tokenizer.hpp"
+
+#define MAX_DEPTH 32
+#define MAX_PLY 64
+#define MAX_MULTIPV 8
+#define MAX_SEARCHMOVES 64
 
 struct History {
   Move m;
-  int castle, ep, half;
+  uint8_t castle;
+  int8_t ep;
+  uint16_t half;
+  U64 hash;
+};
+
+// Search limits of a go command; zero means not given.
+struct GoParams {
+  int wtime, btime, winc, binc, movetime, nodes, movestogo, depth;
 };
 
-extern History history[128];
 extern int histPly;
+extern bool positionValid;
+extern unsigned long nodes;
+extern int multiPV;
 
 bool makeMove(const Move &m);
 void unmakeMove();
+bool inCheck();
 int quiesce(int alpha,int beta);
 int search(int depth,int alpha,int beta);
 Move thinkDepth(int depth);
 Move thinkTime(int milliseconds);
-void parsePosition(const String& s);
-void goCommand(const String& s);
+int searchFrameBytes();
+bool playMove(int from,int to);
+void parsePosition(const char *line);
+bool positionMove(const Token &t);
+void runGo(const GoParams& g);
+void goCommand(const char *line);
+void setOption(const char *line);
+void uciCommand(const char *line);
 void initEngine();
@@ -1,9 +1,9 @@
 #include "move_generator.hpp"
 
-void addMove(MoveList &list, Move m){ list.moves[list.count++] = m; }
+void addMove(MoveBuffer &list, Move m){ list.moves[list.count++] = m; }
 
-void generateMoves(MoveList &list){
-  list.count=0;
+int generateMoves(Move *out){
+  MoveBuffer list = {out, 0};
   U64 bb, attacks;
 
   if(side==WHITE){
@@ -145,4 +145,5 @@ void generateMoves(MoveList &list){
         addMove(list,{60,58,BK,NO_PIECE,NO_PIECE,8,0});
     }
   }
+  return list.count;
 }
@@ -8,10 +8,15 @@ struct Move {
   uint8_t capture;
   uint8_t promo;
   uint8_t flags;
-  int score;
+  int16_t score;
 };
 
-struct MoveList { Move moves[256]; int count; };
+#define MAX_MOVES 256
 
-void addMove(MoveList &list, Move m);
-void generateMoves(MoveList &list);
+struct MoveList { Move moves[MAX_MOVES]; int count; };
+struct MoveBuffer { Move *moves; int count; };
+
+void addMove(MoveBuffer &list, Move m);
+// Writes up to MAX_MOVES pseudo-legal moves to out and returns the count.
+int generateMoves(Move *out);
+inline void generateMoves(MoveList &list){ list.count = generateMoves(list.moves); }
@@ -0,0 +1,193 @@
+#include "protocol.hpp"
+#include "chess_engine.hpp"
+#include "arena.hpp"
+#include <cstdio>
+#include <cstring>
+
+bool binaryMode=false;
+bool quitRequested=false;
+
+static int lineLen=0;    // -1 while discarding an over-long line
+static int movesAt=0;    // >0 while streaming the moves of a position line
+static bool movesDone;   // a non-move token ended the moves list
+
+enum { RX_IDLE, RX_TYPE, RX_LEN_LO, RX_LEN_HI, RX_PAYLOAD, RX_CHECK, RX_SKIP };
+static uint8_t rxState=RX_IDLE;
+static uint8_t rxType, rxCheck;
+static uint16_t rxLen, rxPos;
+static uint32_t rxLast;
+
+static uint32_t get32(const uint8_t *p){ return p[0] | (p[1]<<8) | ((uint32_t)p[2]<<16) | ((uint32_t)p[3]<<24); }
+static uint16_t get16(const uint8_t *p){ return p[0] | (p[1]<<8); }
+static void put32(uint8_t *p, uint32_t v){ p[0]=v; p[1]=v>>8; p[2]=v>>16; p[3]=v>>24; }
+static void put16(uint8_t *p, uint16_t v){ p[0]=v; p[1]=v>>8; }
+
+uint16_t encodeMove(const Move &m){
+  if(m.from==m.to) return MOVE_CODE_NULL;
+  return m.from | (m.to<<6) | ((m.flags & 16) ? 4<<12 : 0);
+}
+
+void moveCodeToStr(uint16_t code, char *buf){
+  int from=code & 63, to=(code>>6) & 63, promo=(code>>12) & 7;
+  if(from==to){ strcpy(buf,"0000"); return; }
+  buf[0]='a'+from%8; buf[1]='1'+from/8; buf[2]='a'+to%8; buf[3]='1'+to/8;
+  if(promo){ buf[4]=" nbrq"[promo]; buf[5]=0; } else buf[4]=0;
+}
+
+static void sendFrame(uint8_t type, const uint8_t *payload, uint16_t len){
+  uint8_t head[4]={FRAME_SYNC, type, (uint8_t)len, (uint8_t)(len>>8)};
+  uint8_t check=type ^ head[2] ^ head[3];
+  for(uint16_t i=0;i<len;i++) check ^= payload[i];
+  Serial.write(head,4);
+  if(len) Serial.write(payload,len);
+  Serial.write(&check,1);
+}
+
+void sendLine(const char *s){
+  if(binaryMode) sendFrame(FRAME_OUT_TEXT,(const uint8_t*)s,strlen(s));
+  else Serial.println(s);
+}
+
+// depth, multipv, mate flag, score i16, nodes u32, time u32, pv length, pv moves
+void sendInfo(const SearchInfo &info){
+  if(binaryMode){
+    uint8_t buf[16 + MAX_PV*2];
+    buf[0]=info.depth; buf[1]=info.multipv; buf[2]=info.mate;
+    put16(buf+3,(uint16_t)(int16_t)info.score);
+    put32(buf+5,info.nodes); put32(buf+9,info.time);
+    buf[13]=info.pvLen;
+    for(int i=0;i<info.pvLen;i++) put16(buf+14+2*i,info.pv[i]);
+    sendFrame(FRAME_INFO,buf,14+2*info.pvLen);
+    return;
+  }
+  char buf[96 + MAX_PV*6];
+  int len=snprintf(buf,sizeof(buf),"info depth %d multipv %d score %s %d nodes %lu time %lu pv",
+                   info.depth,info.multipv,info.mate?"mate":"cp",info.score,info.nodes,info.time);
+  for(int i=0;i<info.pvLen;i++){ buf[len++]=' '; moveCodeToStr(info.pv[i],buf+len); len+=strlen(buf+len); }
+  Serial.println(buf);
+}
+
+void sendBestMove(const Move &bm){
+  if(binaryMode){
+    uint8_t buf[2]; put16(buf,encodeMove(bm));
+    sendFrame(FRAME_BESTMOVE,buf,2);
+    return;
+  }
+  char buf[6];
+  moveCodeToStr(encodeMove(bm),buf);
+  Serial.print("bestmove "); Serial.println(buf);
+}
+
+static void handleFrame(){
+  const uint8_t *p=arena.frame;
+  switch(rxType){
+    case FRAME_TEXT: {
+      arena.frame[rxLen]=0;
+      uciCommand((const char*)arena.frame);
+      break;
+    }
+    case FRAME_POSITION: {
+      if(rxLen<102) return;
+      for(int i=0;i<12;i++) bitboards[i]=(U64)get32(p+8*i) | ((U64)get32(p+8*i+4)<<32);
+      side=p[96]&1; castle=p[97]&15; enpassant=p[98]<64 ? p[98] : -1;
+      halfmove=p[99]; fullmove=get16(p+100);
+      updateOccupancies();
+      hashKey=computeHash();
+      histPly=0;
+      positionValid=true;
+      break;
+    }
+    case FRAME_MOVES: {
+      for(int i=0;i<p[0] && 1+2*i+1<rxLen;i++){
+        uint16_t code=get16(p+1+2*i);
+        if(!playMove(code & 63,(code>>6) & 63)){ positionValid=false; break; }
+      }
+      break;
+    }
+    case FRAME_GO: {
+      if(rxLen<27) return;
+      GoParams g;
+      g.wtime=get32(p); g.btime=get32(p+4); g.winc=get32(p+8); g.binc=get32(p+12);
+      g.movetime=get32(p+16); g.nodes=get32(p+20); g.movestogo=get16(p+24); g.depth=p[26];
+      runGo(g);
+      break;
+    }
+  }
+}
+
+// A GUI resends the whole game with every position command, which soon
+// outgrows the line buffer. Once "position ... moves" has been read the base
+// position is set up and each following move is applied as soon as its
+// token ends, so only the move being received is buffered.
+static void endToken(){
+  if(movesAt>0){
+    Token t={arena.inputLine+movesAt, lineLen-movesAt};
+    if(t.len>0 && !movesDone && !positionMove(t)) movesDone=true;
+    lineLen=movesAt;
+    return;
+  }
+  if(lineLen>=15 && strncmp(arena.inputLine,"position ",9)==0 &&
+     strncmp(arena.inputLine+lineLen-6," moves",6)==0){
+    arena.inputLine[lineLen]=0;
+    parsePosition(arena.inputLine);
+    movesAt=lineLen; movesDone=!positionValid;
+    return;
+  }
+  if(lineLen<INPUT_LINE_MAX) arena.inputLine[lineLen++]=' ';
+  else lineLen=-1;
+}
+
+static void endLine(){
+  if(lineLen<0){
+    if(movesAt>0 || strncmp(arena.inputLine,"position",8)==0){
+      positionValid=false;
+      sendLine("info string position line too long, position dropped");
+    }
+    else sendLine("info string input line too long, ignored");
+  }
+  else if(movesAt>0) endToken();
+  else { arena.inputLine[lineLen]=0; uciCommand(arena.inputLine); }
+  lineLen=0; movesAt=0;
+}
+
+// Feeds one byte from the host. Text lines and frames can be interleaved
+// because UCI text never contains FRAME_SYNC. A sync byte followed by an
+// unknown type, or a frame that stalls for FRAME_GAP_MS, is abandoned so a
+// stray or truncated frame cannot swallow later commands. An oversize
+// frame is skipped whole so its payload never reaches the text line.
+void protocolInput(uint8_t c){
+  uint32_t now=platformMillis();
+  if(rxState!=RX_IDLE && now-rxLast>FRAME_GAP_MS) rxState=RX_IDLE;
+  rxLast=now;
+  switch(rxState){
+    case RX_IDLE:
+      if(c==FRAME_SYNC){ rxState=RX_TYPE; return; }
+      if(c=='\r') return;
+      if(c=='\n') endLine();
+      else if(lineLen<0) return;
+      else if(c==' ' || c=='\t') endToken();
+      else if(lineLen<INPUT_LINE_MAX) arena.inputLine[lineLen++]=c;
+      else lineLen=-1;
+      return;
+    case RX_TYPE:
+      if(c<FRAME_TEXT || c>FRAME_GO){ rxState=RX_IDLE; protocolInput(c); return; }
+      rxType=c; rxCheck=c; rxState=RX_LEN_LO; return;
+    case RX_LEN_LO: rxLen=c; rxCheck^=c; rxState=RX_LEN_HI; return;
+    case RX_LEN_HI:
+      rxLen|=c<<8; rxCheck^=c; rxPos=0;
+      if(rxLen>FRAME_MAX_PAYLOAD){ rxState=RX_SKIP; return; }
+      rxState = rxLen ? RX_PAYLOAD : RX_CHECK;
+      return;
+    case RX_PAYLOAD:
+      arena.frame[rxPos++]=c; rxCheck^=c;
+      if(rxPos==rxLen) rxState=RX_CHECK;
+      return;
+    case RX_CHECK:
+      rxState=RX_IDLE;
+      if(c==rxCheck) handleFrame();
+      return;
+    case RX_SKIP:
+      if(rxPos++==rxLen) rxState=RX_IDLE;
+      return;
+  }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "move_generator.hpp"
+
+// Host link. Text UCI lines are always accepted; bytes starting with
+// FRAME_SYNC are binary frames:
+//   sync, type, len lo, len hi, payload[len], xor of type/len/payload
+// Output switches to frames after "setoption name BinaryFrames value true"
+// and back to text on the next "uci".
+
+#define FRAME_SYNC 0xA5
+#define FRAME_MAX_PAYLOAD 256
+#define FRAME_GAP_MS 50      // a partial frame idle this long is dropped
+#define MAX_PV 32
+
+enum FrameType {
+  FRAME_TEXT      = 0x01,  // host: one UCI command line
+  FRAME_POSITION  = 0x02,  // host: 12 bitboards, side, castle, ep, halfmove, fullmove
+  FRAME_MOVES     = 0x03,  // host: count, moves applied to the current position
+  FRAME_GO        = 0x04,  // host: wtime btime winc binc movetime nodes movestogo depth
+  FRAME_OUT_TEXT  = 0x81,  // engine: one text line (id, readyok, ...)
+  FRAME_INFO      = 0x82,  // engine: one search info record
+  FRAME_BESTMOVE  = 0x83   // engine: best move
+};
+
+// Moves on the wire: from | to<<6 | promo<<12 (promo 0 none, 4 queen).
+// MOVE_CODE_NULL (from==to) is the UCI null move "0000".
+#define MOVE_CODE_NULL 0
+struct SearchInfo {
+  int depth, multipv;
+  int score;                 // centipawns, or moves to mate when mate is set
+  bool mate;
+  unsigned long nodes, time;
+  int pvLen;
+  uint16_t pv[MAX_PV];
+};
+
+extern bool binaryMode;
+extern bool quitRequested;
+
+uint16_t encodeMove(const Move &m);
+void moveCodeToStr(uint16_t code, char *buf);
+
+void protocolInput(uint8_t c);
+void sendLine(const char *s);
+void sendInfo(const SearchInfo &info);
+void sendBestMove(const Move &bm);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstring>
+
+// Zero-copy tokenizer over a NUL terminated command line. Tokens are split
+// on blanks and control characters, point into the line, and nothing is
+// copied or allocated.
+struct Token {
+  const char *s;
+  int len;
+};
+
+struct Tokenizer {
+  const char *p;
+
+  explicit Tokenizer(const char *line): p(line) {}
+
+  bool next(Token &t){
+    while(*p && *p<=' ') p++;
+    if(!*p) return false;
+    t.s = p;
+    while(*p > ' ') p++;
+    t.len = p - t.s;
+    return true;
+  }
+
+  // Remainder of the line after the last token, leading blanks skipped.
+  const char *rest(){
+    while(*p && *p<=' ') p++;
+    return p;
+  }
+};
+
+inline bool tokenIs(const Token &t, const char *word){
+  int n = strlen(word);
+  return t.len==n && strncmp(t.s, word, n)==0;
+}
+
+inline int tokenInt(const Token &t){
+  int i=0, v=0;
+  bool neg = t.len>0 && t.s[0]=='-';
+  if(neg) i++;
+  for(; i<t.len && t.s[i]>='0' && t.s[i]<='9'; i++) v = v*10 + (t.s[i]-'0');
+  return neg ? -v : v;
+}
+
+// Coordinate move such as e2e4 or e7e8q; the promotion piece is ignored.
+inline bool tokenMove(const Token &t, int &from, int &to){
+  if(t.len<4 || t.len>5) return false;
+  const char *s = t.s;
+  if(s[0]<'a' || s[0]>'h' || s[1]<'1' || s[1]>'8' || s[2]<'a' || s[2]>'h' || s[3]<'1' || s[3]>'8') return false;
+  from = (s[1]-'1')*8 + (s[0]-'a');
+  to = (s[3]-'1')*8 + (s[2]-'a');
+  return true;
+}
@@ -0,0 +1,31 @@
+#include "transposition.hpp"
+#include "arena.hpp"
+
+uint8_t ttAge=0;
+
+void clearTT(){
+  for(int i=0;i<TT_ENTRIES;i++) arena.tt[i] = TTEntry{0,0,0,TT_NONE,0,0,0};
+}
+
+TTEntry* probeTT(U64 key){
+  TTEntry &e = arena.tt[key % TT_ENTRIES];
+  return (e.flag!=TT_NONE && e.key==key) ? &e : nullptr;
+}
+
+// Mate scores are stored relative to the node so they stay valid when the
+// position is reached at a different distance from the root.
+void storeTT(U64 key, int depth, int score, int flag, const Move &best, int ply){
+  TTEntry &e = arena.tt[key % TT_ENTRIES];
+  if(e.key!=key && e.flag!=TT_NONE && e.age==ttAge && e.depth>depth) return;
+  if(score > MATE_BOUND) score += ply;
+  else if(score < -MATE_BOUND) score -= ply;
+  e.key = key; e.score = (int16_t)score; e.depth = (uint8_t)depth; e.flag = (uint8_t)flag;
+  e.from = best.from; e.to = best.to; e.age = ttAge;
+}
+
+int ttScore(const TTEntry &e, int ply){
+  int s = e.score;
+  if(s > MATE_BOUND) return s - ply;
+  if(s < -MATE_BOUND) return s + ply;
+  return s;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "move_generator.hpp"
+
+#ifndef TT_ENTRIES
+#define TT_ENTRIES 2048
+#endif
+
+#define MATE_SCORE 32000
+#define MATE_BOUND 31000
+
+enum TTFlag { TT_NONE, TT_EXACT, TT_LOWER, TT_UPPER };
+
+struct TTEntry {
+  U64 key;
+  int16_t score;
+  uint8_t depth;
+  uint8_t flag;
+  uint8_t from, to;
+  uint8_t age;
+};
+
+extern uint8_t ttAge;
+
+void clearTT();
+TTEntry* probeTT(U64 key);
+void storeTT(U64 key, int depth, int score, int flag, const Move &best, int ply);
+int ttScore(const TTEntry &e, int ply);
@@ -57,6 +57,7 @@ public:
     void println(const char* str) { std::cout << str << std::endl; }
     void println(const std::string& str) { std::cout << str << std::endl; }
     void println(int value) { std::cout << value << std::endl; }
+    void write(const uint8_t* buf, size_t len) { std::cout.write((const char*)buf, len); std::cout.flush(); }
     bool available() { return false; }
     char read() { return 0; }
     operator bool() const { return true; }
@@ -1,11 +1,235 @@
 #include "mock_arduino.hpp"
 #include "../src/chess_engine.hpp"
+#include "../src/arena.hpp"
+#include "../tools/sprt.hpp"
+#include <cmath>
+#include <cstring>
+#include <sstream>
 
 MockSerial Serial;
 
+static int failures = 0;
+
+static void check(bool ok, const char* name){
+    std::cout << (ok ? "ok   " : "FAIL ") << name << std::endl;
+    if(!ok) failures++;
+}
+
+static bool near(double a, double b){ return std::fabs(a - b) < 1e-3; }
+
+// Runs UCI command lines and returns what the engine printed.
+static std::string run(const std::string& input){
+    std::ostringstream out;
+    std::streambuf* old = std::cout.rdbuf(out.rdbuf());
+    std::istringstream lines(input);
+    std::string line;
+    while(std::getline(lines, line)) uciCommand(line.c_str());
+    std::cout.rdbuf(old);
+    return out.str();
+}
+
+// Feeds raw host bytes through protocolInput and returns the output.
+static std::string feed(const std::string& bytes){
+    std::ostringstream out;
+    std::streambuf* old = std::cout.rdbuf(out.rdbuf());
+    for(unsigned char c : bytes) protocolInput(c);
+    std::cout.rdbuf(old);
+    return out.str();
+}
+
+static std::string frame(uint8_t type, const std::string& payload){
+    std::string f;
+    f += (char)FRAME_SYNC; f += (char)type;
+    f += (char)(payload.size() & 0xFF); f += (char)(payload.size() >> 8);
+    uint8_t check = type ^ (payload.size() & 0xFF) ^ (payload.size() >> 8);
+    for(unsigned char c : payload) check ^= c;
+    return f + payload + (char)check;
+}
+
+static int count(const std::string& s, const std::string& what){
+    int n = 0;
+    for(size_t p = s.find(what); p != std::string::npos; p = s.find(what, p + 1)) n++;
+    return n;
+}
+
+static bool searchStateClean(){
+    return moveTop == arena.moveStack && hashKey == computeHash();
+}
+
+static std::string bestMove(const std::string& output){
+    size_t p = output.rfind("bestmove ");
+    if(p == std::string::npos) return "";
+    return output.substr(p + 9, output.find('\n', p) - p - 9);
+}
+
+// Last "info depth d multipv k" line.
+static std::string infoLine(const std::string& output, int depth, int k){
+    char key[40];
+    snprintf(key, sizeof(key), "info depth %d multipv %d ", depth, k);
+    size_t p = output.rfind(key);
+    if(p == std::string::npos) return "";
+    return output.substr(p, output.find('\n', p) - p);
+}
+
+static int lineScore(const std::string& line){
+    size_t p = line.find("score cp ");
+    return p == std::string::npos ? -100000 : atoi(line.c_str() + p + 9);
+}
+
+static int pvLength(const std::string& line){
+    size_t p = line.find(" pv");
+    if(p == std::string::npos) return 0;
+    std::istringstream moves(line.substr(p + 3));
+    std::string mv;
+    int n = 0;
+    while(moves >> mv) n++;
+    return n;
+}
+
+static void testSprt(){
+    Sprt sprt = {0.0, 5.0, 0.05, 0.05};
+    check(near(sprt.lowerBound(), -2.944) && near(sprt.upperBound(), 2.944), "SPRT bounds");
+    check(near(sprt.llr(60, 20, 20), 0.883) && sprt.status(60, 20, 20) == 0, "SPRT continues on a short lead");
+    check(near(sprt.llr(600, 200, 200), 8.832) && sprt.status(600, 200, 200) == 1, "SPRT accepts H1");
+    check(near(sprt.llr(200, 200, 600), -9.156) && sprt.status(200, 200, 600) == -1, "SPRT accepts H0");
+    check(near(sprt.llr(3300, 3000, 3000), 4.959) && sprt.llr(0, 0, 0) == 0.0, "SPRT LLR values");
+    double elo, margin;
+    eloEstimate(60, 20, 20, elo, margin);
+    check(near(elo, 147.191) && margin > 0, "Elo estimate");
+}
+
+static void testPlayMove(){
+    setStartPos();
+    halfmove = 0; fullmove = 1;
+    check(!playMove(12, 36), "playMove rejects an illegal move");
+    check(playMove(13, 21) && playMove(52, 36) && playMove(14, 30) && playMove(59, 31), "playMove plays legal moves");
+    check(inCheck() && fullmove == 3 && halfmove == 1, "inCheck and move clocks after fool's mate");
+}
+
+static void testMultiPV(){
+    // Black queen, rook and knight all hang to white pieces.
+    const char* hanging = "position fen 4k3/8/8/3q4/2P1r1n1/3P4/8/6RK w - - 0 1\n";
+    std::string out = run(std::string("setoption name MultiPV value 3\n") + hanging + "go depth 2\n");
+    int s1 = lineScore(infoLine(out, 2, 1)), s2 = lineScore(infoLine(out, 2, 2)), s3 = lineScore(infoLine(out, 2, 3));
+    check(s1 >= s2 && s2 >= s3 && s3 > -100000 && hashKey == computeHash(), "MultiPV lines are ordered best first");
+
+    out = run("position startpos moves e2e4 e7e5\ngo depth 4\n");
+    bool full = true;
+    for(int k = 1; k <= 3; k++) full = full && pvLength(infoLine(out, 4, k)) == 4;
+    check(full, "every MultiPV line carries a full-depth PV");
+    run("setoption name MultiPV value 1\n");
+
+    out = run(std::string(hanging) + "go depth 2 searchmoves d3e4 h1g2\n");
+    check(bestMove(out) == "d3e4", "searchmoves restricts the root");
+    out = run(std::string(hanging) + "go depth 2 searchmoves a1a2\n");
+    check(bestMove(out) == "0000", "no legal searchmoves answers the null move");
+    out = run("position fen 6k1/5ppp/8/8/8/8/5PPP/r5K1 w - - 0 1\ngo depth 3\n");
+    check(bestMove(out) == "0000", "mated side answers the null move");
+}
+
+static void testFrames(){
+    check(count(feed(frame(FRAME_TEXT, "isready")), "readyok") == 1, "text frame runs its command");
+    std::string stray(1, (char)FRAME_SYNC);
+    check(count(feed(stray + "isready\n"), "readyok") == 1, "stray sync byte is read as text");
+
+    std::string big;
+    while(big.size() < 300) big += "isready\n";
+    check(count(feed(frame(FRAME_TEXT, big) + "isready\n"), "readyok") == 1, "oversize frame is skipped whole");
+
+    std::string moves = "\x01";
+    moves += (char)(12 | (28 << 6)); moves += (char)((12 | (28 << 6)) >> 8);
+    feed("position startpos\n" + frame(FRAME_MOVES, moves));
+    check(side == BLACK && (bitboards[WP] >> 28 & 1), "moves frame plays e2e4");
+    check(bestMove(feed("position fen 6k1/5ppp/8/8/8/8/5PPP/r5K1 w - - 0 1\ngo depth 1\n")) == "0000", "mated side answers 0000 over the link");
+}
+
+static void testTokenizer(){
+    Tokenizer tk("  go\tdepth -12  e7e8q\r\n");
+    Token t;
+    int from, to;
+    check(tk.next(t) && tokenIs(t, "go") && !tokenIs(t, "g"), "tokenizer splits on blanks");
+    check(tk.next(t) && tokenIs(t, "depth") && tk.next(t) && tokenInt(t) == -12, "tokenInt reads signed values");
+    check(tk.next(t) && tokenMove(t, from, to) && from == 52 && to == 60, "tokenMove reads promotions");
+    check(!tk.next(t) && *tk.rest() == 0, "tokenizer stops at control characters");
+    Token bad = {"e9e4", 4};
+    check(!tokenMove(bad, from, to), "tokenMove rejects off-board squares");
+}
+
+static void testPosition(){
+    feed("position startpos moves e2e4 e7e5 g1f3\n");
+    U64 expected = hashKey;
+    feed("position fen rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 moves e2e4 e7e5 g1f3\n");
+    check(hashKey == expected && side == BLACK && hashKey == computeHash(), "position fen ... moves matches startpos");
+
+    // 240 plies of knight moves pass INPUT_LINE_MAX and return to the start.
+    std::string line = "position startpos moves";
+    for(int i = 0; i < 60; i++) line += " g1f3 g8f6 f3g1 f6g8";
+    feed("position startpos\n");
+    expected = hashKey;
+    check(line.size() > INPUT_LINE_MAX, "long game exceeds the line buffer");
+    feed(line + " e2e4\n");
+    U64 longGame = hashKey;
+    feed("position startpos moves e2e4\n");
+    check(positionValid && longGame == hashKey, "long position lines are streamed");
+    feed(line + "\n");
+    check(hashKey == expected, "long position line without trailing move");
+
+    std::string out = feed("position startpos moves e2e4 " + std::string(2000, 'x') + "\ngo depth 1\n");
+    check(!positionValid && bestMove(out) == "0000", "overflowing position line refuses go");
+    out = feed("setoption name " + std::string(2000, 'y') + "\nisready\nposition startpos\n");
+    check(out.find("too long") != std::string::npos && out.find("readyok") != std::string::npos && positionValid,
+          "over-long command is ignored");
+    out = feed("position fen nonsense\ngo depth 1\n");
+    check(bestMove(out) == "0000", "bad FEN refuses go");
+
+    out = feed("position startpos moves e2e4 e2e4 d7d5\ngo depth 1\n");
+    check(!positionValid && side == BLACK && bestMove(out) == "0000", "illegal move stops the moves list");
+    out = feed(line + " e2e5 e2e4\ngo depth 1\n");
+    check(!positionValid && bestMove(out) == "0000", "illegal move in a streamed position line");
+    std::string moves = "\x02";
+    moves += (char)(12 | (36 << 6)); moves += (char)((12 | (36 << 6)) >> 8);
+    moves += (char)(52 | (36 << 6)); moves += (char)((52 | (36 << 6)) >> 8);
+    feed("position startpos\n" + frame(FRAME_MOVES, moves));
+    check(!positionValid, "illegal move in a moves frame");
+    feed("position startpos\n");
+}
+
+static void testSearchLimits(){
+    std::string out = feed("position startpos\ngo depth 3\n");
+    check(bestMove(out).size() == 4 && searchStateClean(), "search restores move stack and hash");
+
+    moveTop = arena.moveStack + MOVE_STACK_MOVES - MAX_MOVES + 1;
+    Move* mark = moveTop;
+    markSearchStack();
+    int score = search(3, -MATE_SCORE, MATE_SCORE);
+    check(moveStackFull() && score == evaluate() && moveTop == mark, "full move stack falls back to evaluate");
+    moveTop = arena.moveStack;
+
+    markSearchStack();
+    stackBase += SEARCH_STACK_BYTES;
+    score = search(3, -MATE_SCORE, MATE_SCORE);
+    check(score == evaluate() && searchStateClean(), "exhausted search stack falls back to evaluate");
+
+    std::ostringstream report;
+    std::streambuf* old = std::cout.rdbuf(report.rdbuf());
+    reportMemory();
+    std::cout.rdbuf(old);
+    int frameBytes = searchFrameBytes();
+    check(frameBytes > 0 && frameBytes < SEARCH_STACK_BYTES && report.str().find("zobrist 6336 attacks 2048") != std::string::npos &&
+          report.str().find("safe depth") != std::string::npos, "memory report covers tables and search stack");
+}
+
 int main(){
     initEngine();
     int score = evaluate();
     std::cout << "Initial score: " << score << std::endl;
-    return 0;
+    testSprt();
+    testPlayMove();
+    testMultiPV();
+    testFrames();
+    testTokenizer();
+    testPosition();
+    testSearchLimits();
+    std::cout << (failures ? "FAILED " : "passed ") << failures << " failures" << std::endl;
+    return failures ? 1 : 0;
 }
@@ -0,0 +1,490 @@
+#include "mock_arduino.hpp"
+#include "../src/chess_engine.hpp"
+#include "sprt.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+MockSerial Serial;
+
+// Self-play match runner. Two UCI engine binaries (usually the same sources
+// built with different flags) play paired games from an opening suite; each
+// worker process owns one engine of each kind and the board code linked in
+// here adjudicates. Results feed a running SPRT in the parent.
+
+struct Options {
+  std::string engineA="./engine_a";
+  std::string engineB="./engine_b";
+  std::string openings;
+  int games=1000;
+  int jobs=0;
+  int nodes=0;
+  int movetime=0;
+  int depth=0;
+  int maxPlies=300;
+  int randomPlies=0;
+  int timeoutMs=10000;
+  Sprt sprt={0.0,5.0,0.05,0.05};
+};
+
+struct Opening {
+  std::string fen;
+  std::vector<std::string> moves;
+};
+
+static const char* defaultOpenings[] = {
+  "e2e4 e7e5 g1f3 b8c6",
+  "e2e4 c7c5 g1f3 d7d6",
+  "e2e4 e7e6 d2d4 d7d5",
+  "e2e4 c7c6 d2d4 d7d5",
+  "d2d4 d7d5 c2c4 e7e6",
+  "d2d4 g8f6 c2c4 g7g6",
+  "c2c4 e7e5 b1c3 g8f6",
+  "g1f3 d7d5 g2g3 g8f6",
+};
+
+static volatile sig_atomic_t stopRequested=0;
+static void onTerminate(int){ stopRequested=1; }
+
+static bool makePipe(int fds[2]){
+  if(pipe(fds)!=0) return false;
+  fcntl(fds[0],F_SETFD,FD_CLOEXEC);
+  fcntl(fds[1],F_SETFD,FD_CLOEXEC);
+  return true;
+}
+
+struct Engine {
+  std::string path;
+  pid_t pid=-1;
+  int in=-1, out=-1;
+  std::string buf;
+
+  bool start(){
+    int toChild[2], fromChild[2];
+    if(!makePipe(toChild)) return false;
+    if(!makePipe(fromChild)){ close(toChild[0]); close(toChild[1]); return false; }
+    pid=fork();
+    if(pid<0) return false;
+    if(pid==0){
+      dup2(toChild[0],STDIN_FILENO);
+      dup2(fromChild[1],STDOUT_FILENO);
+      execl(path.c_str(),path.c_str(),(char*)nullptr);
+      _exit(127);
+    }
+    close(toChild[0]); close(fromChild[1]);
+    in=toChild[1]; out=fromChild[0]; buf.clear();
+    std::string line;
+    return send("uci") && waitFor("uciok",line,5000);
+  }
+
+  void stop(){
+    if(pid<=0) return;
+    send("quit");
+    close(in); close(out);
+    kill(pid,SIGKILL);
+    waitpid(pid,nullptr,0);
+    pid=-1; in=out=-1;
+  }
+
+  bool send(const std::string& line){
+    std::string s=line+"\n";
+    const char* p=s.c_str(); size_t left=s.size();
+    while(left){
+      ssize_t n=write(in,p,left);
+      if(n<0){ if(errno==EINTR && !stopRequested) continue; return false; }
+      p+=n; left-=n;
+    }
+    return true;
+  }
+
+  bool readLine(std::string& line,int timeoutMs){
+    uint32_t deadline=platformMillis()+timeoutMs;
+    for(;;){
+      size_t nl=buf.find('\n');
+      if(nl!=std::string::npos){
+        line=buf.substr(0,nl); buf.erase(0,nl+1);
+        if(!line.empty() && line.back()=='\r') line.pop_back();
+        return true;
+      }
+      int left=(int)(deadline-platformMillis());
+      if(left<=0 || stopRequested) return false;
+      pollfd pfd={out,POLLIN,0};
+      int r=poll(&pfd,1,left);
+      if(r<0){ if(errno==EINTR) continue; return false; }
+      if(r==0) return false;
+      char chunk[512];
+      ssize_t n=read(out,chunk,sizeof(chunk));
+      if(n<=0) return false;
+      buf.append(chunk,n);
+    }
+  }
+
+  bool waitFor(const std::string& prefix,std::string& line,int timeoutMs){
+    uint32_t deadline=platformMillis()+timeoutMs;
+    for(;;){
+      int left=(int)(deadline-platformMillis());
+      if(left<=0 || !readLine(line,left)) return false;
+      if(line.compare(0,prefix.size(),prefix)==0) return true;
+    }
+  }
+
+  bool ready(){
+    std::string line;
+    return send("isready") && waitFor("readyok",line,5000);
+  }
+};
+
+// Plays a UCI move on the global board. The engine only promotes to a queen.
+static bool applyUci(const std::string& uci){
+  if(uci.size()<4 || uci.size()>5) return false;
+  if(uci.size()==5 && uci[4]!='q') return false;
+  return playMove((uci[1]-'1')*8+(uci[0]-'a'), (uci[3]-'1')*8+(uci[2]-'a'));
+}
+
+static std::string moveToUci(const Move& m){
+  std::string s={(char)('a'+m.from%8),(char)('1'+m.from/8),(char)('a'+m.to%8),(char)('1'+m.to/8)};
+  if(m.flags & 16) s+='q';
+  return s;
+}
+
+static int legalMoves(std::vector<Move>& out){
+  out.clear();
+  MoveList list; generateMoves(list);
+  for(int i=0;i<list.count;i++){
+    if(makeMove(list.moves[i])){ unmakeMove(); out.push_back(list.moves[i]); }
+  }
+  return (int)out.size();
+}
+
+static bool hasLegalMove(){
+  std::vector<Move> moves;
+  return legalMoves(moves)>0;
+}
+
+static bool insufficientMaterial(){
+  if(bitboards[WP]|bitboards[BP]|bitboards[WR]|bitboards[BR]|bitboards[WQ]|bitboards[BQ]) return false;
+  return countBits(bitboards[WN]|bitboards[BN]|bitboards[WB]|bitboards[BB]) <= 1;
+}
+
+// Placement, side, castling and en passant: the part of the FEN that
+// identifies a position for repetition detection.
+static std::string positionKey(){
+  static const char pieceChar[]="PNBRQKpnbrqk";
+  std::string s;
+  for(int r=7;r>=0;r--){
+    int empty=0;
+    for(int f=0;f<8;f++){
+      int p=pieceAt(r*8+f);
+      if(p==NO_PIECE){ empty++; continue; }
+      if(empty){ s+=(char)('0'+empty); empty=0; }
+      s+=pieceChar[p];
+    }
+    if(empty) s+=(char)('0'+empty);
+    if(r) s+='/';
+  }
+  s+= side==WHITE ? " w " : " b ";
+  if(!castle) s+='-';
+  if(castle & WKC) s+='K';
+  if(castle & WQC) s+='Q';
+  if(castle & BKC) s+='k';
+  if(castle & BQC) s+='q';
+  s+=' ';
+  if(enpassant<0) s+='-';
+  else { s+=(char)('a'+enpassant%8); s+=(char)('1'+enpassant/8); }
+  return s;
+}
+
+static std::string currentFEN(){
+  return positionKey()+" "+std::to_string(halfmove)+" "+std::to_string(fullmove);
+}
+
+static bool setupOpening(const Opening& op){
+  histPly=0;
+  if(op.fen.empty()){ setStartPos(); halfmove=0; fullmove=1; }
+  else {
+    if(!loadFEN(op.fen.c_str())) return false;
+    std::istringstream ss(op.fen);
+    std::string field; int idx=0; halfmove=0; fullmove=1;
+    while(ss>>field){
+      if(idx==4) halfmove=atoi(field.c_str());
+      if(idx==5) fullmove=atoi(field.c_str());
+      idx++;
+    }
+  }
+  for(const std::string& mv : op.moves) if(!applyUci(mv)) return false;
+  return true;
+}
+
+static std::string goCommandFor(const Options& o){
+  if(o.nodes>0) return "go nodes "+std::to_string(o.nodes);
+  if(o.depth>0) return "go depth "+std::to_string(o.depth);
+  return "go movetime "+std::to_string(o.movetime>0 ? o.movetime : 100);
+}
+
+// Result from white's point of view: 1 win, 0 draw, -1 loss. crashed is set
+// to the engine that stopped answering so the worker can restart it.
+static int playGame(Engine* white,Engine* black,const Opening& op,const Options& o,
+                    std::string& reason,Engine*& crashed){
+  crashed=nullptr;
+  if(!setupOpening(op)){ reason="bad opening"; return 0; }
+  std::map<std::string,int> seen;
+  seen[positionKey()]++;
+  std::string go=goCommandFor(o);
+  int timeout=o.timeoutMs+(o.nodes<=0 && o.depth<=0 ? o.movetime : 0);
+  for(int ply=0;;ply++){
+    int stm = side==WHITE ? 1 : -1;
+    if(!hasLegalMove()){
+      if(inCheck()){ reason="checkmate"; return -stm; }
+      reason="stalemate"; return 0;
+    }
+    if(halfmove>=100){ reason="50-move rule"; return 0; }
+    if(seen[positionKey()]>=3){ reason="repetition"; return 0; }
+    if(insufficientMaterial()){ reason="insufficient material"; return 0; }
+    if(ply>=o.maxPlies){ reason="max plies"; return 0; }
+
+    Engine* e = side==WHITE ? white : black;
+    std::string line;
+    if(!e->send("position fen "+currentFEN()) || !e->send(go) || !e->waitFor("bestmove",line,timeout)){
+      crashed=e; reason="no response"; return -stm;
+    }
+    std::istringstream ss(line);
+    std::string tok, mv;
+    ss>>tok>>mv;
+    if(!applyUci(mv)){ reason="illegal move "+mv; return -stm; }
+    seen[positionKey()]++;
+  }
+}
+
+// One opening per game pair. The engines are deterministic, so a repeated
+// start position would replay the same game and count twice in the SPRT.
+// Each pair extends a suite entry by randomPlies random legal moves (seeded
+// by the pair index) and only positions not seen before are kept; without
+// random plies the suite itself limits the match to 2 games per opening.
+static std::vector<Opening> pairOpenings(const Options& o,const std::vector<Opening>& ops){
+  std::vector<Opening> pairs;
+  std::set<std::string> seen;
+  std::vector<Move> moves;
+  int wanted=(o.games+1)/2;
+  for(int p=0; (int)pairs.size()<wanted && p<wanted*20; p++){
+    Opening op=ops[p%ops.size()];
+    if(o.randomPlies<=0 && p>=(int)ops.size()) break;
+    std::mt19937 rng(p);
+    setupOpening(op);
+    for(int i=0;i<o.randomPlies && legalMoves(moves)>0;i++){
+      const Move& m=moves[rng()%moves.size()];
+      op.moves.push_back(moveToUci(m));
+      applyUci(op.moves.back());
+    }
+    if(!hasLegalMove() || !seen.insert(positionKey()).second) continue;
+    pairs.push_back(op);
+  }
+  return pairs;
+}
+
+static void runWorker(int id,const Options& o,const std::vector<Opening>& ops,int fd){
+  struct sigaction sa;
+  memset(&sa,0,sizeof(sa));
+  sa.sa_handler=onTerminate;
+  sigaction(SIGTERM,&sa,nullptr);
+  Engine a, b;
+  a.path=o.engineA; b.path=o.engineB;
+  if(!a.start() || !b.start()){
+    fprintf(stderr,"worker %d: failed to start engines\n",id);
+    a.stop(); b.stop();
+    _exit(1);
+  }
+  for(int g=id; g<o.games && !stopRequested; g+=o.jobs){
+    const Opening& op=ops[g/2];
+    bool aWhite = g%2==0;
+    a.send("ucinewgame"); b.send("ucinewgame");
+    if(!a.ready() || !b.ready()) break;
+    std::string reason; Engine* crashed;
+    int r=playGame(aWhite?&a:&b, aWhite?&b:&a, op, o, reason, crashed);
+    if(stopRequested) break;
+    int resultA = aWhite ? r : -r;
+    std::string msg=std::to_string(g)+" "+std::to_string(resultA)+" "+reason+"\n";
+    if(write(fd,msg.c_str(),msg.size())<0) break;
+    if(crashed){ crashed->stop(); if(!crashed->start()) break; }
+  }
+  a.stop(); b.stop();
+  _exit(0);
+}
+
+static bool loadOpenings(const std::string& file,std::vector<Opening>& ops){
+  std::vector<std::string> lines;
+  if(file.empty()){
+    for(const char* l : defaultOpenings) lines.push_back(l);
+  } else {
+    std::ifstream in(file);
+    if(!in){ fprintf(stderr,"cannot open %s\n",file.c_str()); return false; }
+    std::string l;
+    while(std::getline(in,l)){
+      size_t b=l.find_first_not_of(" \t\r"), e=l.find_last_not_of(" \t\r");
+      if(b==std::string::npos || l[b]=='#') continue;
+      lines.push_back(l.substr(b,e-b+1));
+    }
+  }
+  // A line is either a FEN/EPD record or a list of moves from the start position.
+  for(const std::string& l : lines){
+    Opening op;
+    std::istringstream ss(l);
+    std::string tok;
+    if(l.find('/')!=std::string::npos){
+      std::vector<std::string> f;
+      while(ss>>tok && f.size()<6) f.push_back(tok);
+      if(f.size()<4) continue;
+      size_t keep = (f.size()==6 && isdigit((unsigned char)f[4][0]) && isdigit((unsigned char)f[5][0])) ? 6 : 4;
+      for(size_t i=0;i<keep;i++) op.fen += (i?" ":"")+f[i];
+    } else {
+      while(ss>>tok) op.moves.push_back(tok);
+    }
+    if(!setupOpening(op)){ fprintf(stderr,"skipping bad opening: %s\n",l.c_str()); continue; }
+    ops.push_back(op);
+  }
+  if(ops.empty()){ fprintf(stderr,"no usable openings\n"); return false; }
+  return true;
+}
+
+static void printUsage(){
+  printf("Self-play match runner for PicoChess builds\n");
+  printf("Usage: selfplay [options]\n\n");
+  printf("  -a <engine>          First engine binary (default: ./engine_a)\n");
+  printf("  -b <engine>          Second engine binary (default: ./engine_b)\n");
+  printf("  -games <n>           Maximum number of games (default: 1000)\n");
+  printf("  -concurrency <n>     Parallel games (default: all cores)\n");
+  printf("  -nodes <n>           Fixed nodes per move\n");
+  printf("  -depth <n>           Fixed depth per move\n");
+  printf("  -movetime <ms>       Fixed time per move (default: 100)\n");
+  printf("  -openings <file>     FEN/EPD or move-list suite, one per line\n");
+  printf("  -randomplies <n>     Random legal plies added to each opening pair (default: 0)\n");
+  printf("  -maxplies <n>        Adjudicate a draw after n plies (default: 300)\n");
+  printf("  -timeout <ms>        Extra time before a silent engine forfeits (default: 10000)\n");
+  printf("  -elo0, -elo1 <elo>   SPRT hypotheses (default: 0 and 5)\n");
+  printf("  -alpha, -beta <p>    SPRT error rates (default: 0.05)\n");
+}
+
+static bool parseArgs(int argc,char** argv,Options& o){
+  for(int i=1;i<argc;i++){
+    std::string arg=argv[i];
+    bool hasValue = i+1<argc;
+    if(arg=="-help" || arg=="-h"){ printUsage(); exit(0); }
+    if(!hasValue){ fprintf(stderr,"missing value for %s\n",arg.c_str()); return false; }
+    const char* v=argv[++i];
+    if(arg=="-a") o.engineA=v;
+    else if(arg=="-b") o.engineB=v;
+    else if(arg=="-games") o.games=atoi(v);
+    else if(arg=="-concurrency") o.jobs=atoi(v);
+    else if(arg=="-nodes") o.nodes=atoi(v);
+    else if(arg=="-depth") o.depth=atoi(v);
+    else if(arg=="-movetime") o.movetime=atoi(v);
+    else if(arg=="-openings") o.openings=v;
+    else if(arg=="-maxplies") o.maxPlies=atoi(v);
+    else if(arg=="-randomplies") o.randomPlies=atoi(v);
+    else if(arg=="-timeout") o.timeoutMs=atoi(v);
+    else if(arg=="-elo0") o.sprt.elo0=atof(v);
+    else if(arg=="-elo1") o.sprt.elo1=atof(v);
+    else if(arg=="-alpha") o.sprt.alpha=atof(v);
+    else if(arg=="-beta") o.sprt.beta=atof(v);
+    else { fprintf(stderr,"unknown option %s\n",arg.c_str()); return false; }
+  }
+  if(o.games<=0) return false;
+  if(o.jobs<=0) o.jobs=std::thread::hardware_concurrency();
+  if(o.jobs<=0) o.jobs=1;
+  if(o.jobs>o.games) o.jobs=o.games;
+  return true;
+}
+
+int main(int argc,char** argv){
+  Options o;
+  if(!parseArgs(argc,argv,o)){ printUsage(); return 2; }
+  initEngine();
+  std::vector<Opening> ops;
+  if(!loadOpenings(o.openings,ops)) return 2;
+  std::vector<Opening> pairs=pairOpenings(o,ops);
+  if((int)pairs.size()*2<o.games){
+    printf("only %d distinct openings: limiting the match to %d games (use a larger -openings suite or -randomplies)\n",
+           (int)pairs.size(),(int)pairs.size()*2);
+    o.games=(int)pairs.size()*2;
+    if(o.jobs>o.games) o.jobs=o.games;
+  }
+  signal(SIGPIPE,SIG_IGN);
+
+  printf("%s vs %s: %d games, %d openings, %d workers, %s\n",
+         o.engineA.c_str(),o.engineB.c_str(),o.games,(int)pairs.size(),o.jobs,goCommandFor(o).c_str());
+  printf("SPRT elo0=%.1f elo1=%.1f alpha=%.3f beta=%.3f bounds [%.2f, %.2f]\n",
+         o.sprt.elo0,o.sprt.elo1,o.sprt.alpha,o.sprt.beta,o.sprt.lowerBound(),o.sprt.upperBound());
+  fflush(stdout);
+
+  std::vector<pid_t> pids;
+  std::vector<pollfd> fds;
+  std::vector<std::string> bufs;
+  for(int w=0; w<o.jobs; w++){
+    int p[2];
+    if(!makePipe(p)){ perror("pipe"); break; }
+    pid_t pid=fork();
+    if(pid<0){ perror("fork"); close(p[0]); close(p[1]); break; }
+    if(pid==0){ close(p[0]); runWorker(w,o,pairs,p[1]); }
+    close(p[1]);
+    pids.push_back(pid);
+    fds.push_back({p[0],POLLIN,0});
+    bufs.emplace_back();
+  }
+
+  int wins=0, draws=0, losses=0, open=(int)fds.size(), verdict=0;
+  std::map<std::string,int> reasons;
+  while(open>0 && verdict==0){
+    if(poll(fds.data(),fds.size(),-1)<0){ if(errno==EINTR) continue; break; }
+    for(size_t i=0;i<fds.size();i++){
+      if(fds[i].fd<0 || !(fds[i].revents & (POLLIN|POLLHUP))) continue;
+      char chunk[512];
+      ssize_t n=read(fds[i].fd,chunk,sizeof(chunk));
+      if(n<=0){ close(fds[i].fd); fds[i].fd=-1; open--; continue; }
+      bufs[i].append(chunk,n);
+      size_t nl;
+      while((nl=bufs[i].find('\n'))!=std::string::npos){
+        std::string line=bufs[i].substr(0,nl); bufs[i].erase(0,nl+1);
+        std::istringstream ss(line);
+        int g, r; std::string reason;
+        ss>>g>>r; std::getline(ss,reason);
+        if(!reason.empty() && reason[0]==' ') reason.erase(0,1);
+        if(r>0) wins++; else if(r<0) losses++; else draws++;
+        reasons[reason]++;
+        double elo, margin; eloEstimate(wins,draws,losses,elo,margin);
+        printf("game %4d  %-22s  W %d D %d L %d  elo %+.1f +/- %.1f  LLR %.2f\n",
+               g+1,reason.c_str(),wins,draws,losses,elo,margin,o.sprt.llr(wins,draws,losses));
+        fflush(stdout);
+        verdict=o.sprt.status(wins,draws,losses);
+        if(verdict) break;
+      }
+      if(verdict) break;
+    }
+  }
+
+  for(pid_t pid : pids) kill(pid,SIGTERM);
+  for(pid_t pid : pids) waitpid(pid,nullptr,0);
+  for(const pollfd& p : fds) if(p.fd>=0) close(p.fd);
+
+  double elo, margin; eloEstimate(wins,draws,losses,elo,margin);
+  printf("\nResult: %s vs %s  W %d D %d L %d  elo %+.1f +/- %.1f\n",
+         o.engineA.c_str(),o.engineB.c_str(),wins,draws,losses,elo,margin);
+  for(const auto& r : reasons) printf("  %-22s %d\n",r.first.c_str(),r.second);
+  printf("SPRT: %s (LLR %.2f)\n",
+         verdict>0 ? "H1 accepted" : verdict<0 ? "H0 accepted" : "inconclusive",
+         o.sprt.llr(wins,draws,losses));
+  return 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cmath>
+
+// Sequential probability ratio test on W/D/L counts using the normal
+// approximation of the game score (trinomial GSPRT).
+struct Sprt {
+  double elo0, elo1, alpha, beta;
+
+  static double scoreFromElo(double elo){ return 1.0/(1.0+std::pow(10.0,-elo/400.0)); }
+  static double eloFromScore(double s){
+    if(s<=0.0) return -999.0;
+    if(s>=1.0) return 999.0;
+    return -400.0*std::log10(1.0/s-1.0);
+  }
+
+  double lowerBound() const { return std::log(beta/(1.0-alpha)); }
+  double upperBound() const { return std::log((1.0-beta)/alpha); }
+
+  double llr(int wins,int draws,int losses) const {
+    int n=wins+draws+losses;
+    if(n==0) return 0.0;
+    double m=(wins+0.5*draws)/n;
+    double var=(wins*(1.0-m)*(1.0-m) + draws*(0.5-m)*(0.5-m) + losses*m*m)/n;
+    if(var<=0.0) return 0.0;
+    double s0=scoreFromElo(elo0), s1=scoreFromElo(elo1);
+    return n*(s1-s0)*(2.0*m-s0-s1)/(2.0*var);
+  }
+
+  // -1 accept H0, +1 accept H1, 0 continue
+  int status(int wins,int draws,int losses) const {
+    double l=llr(wins,draws,losses);
+    if(l>=upperBound()) return 1;
+    if(l<=lowerBound()) return -1;
+    return 0;
+  }
+};
+
+// Elo difference with a 95% confidence half-width.
+inline void eloEstimate(int wins,int draws,int losses,double &elo,double &margin){
+  int n=wins+draws+losses;
+  elo=0.0; margin=0.0;
+  if(n==0) return;
+  double m=(wins+0.5*draws)/n;
+  double var=(wins*(1.0-m)*(1.0-m) + draws*(0.5-m)*(0.5-m) + losses*m*m)/n;
+  double dev=1.96*std::sqrt(var/n);
+  elo=Sprt::eloFromScore(m);
+  margin=(Sprt::eloFromScore(m+dev)-Sprt::eloFromScore(m-dev))/2.0;
+}
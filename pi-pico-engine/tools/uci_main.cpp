@@ -0,0 +1,17 @@
+#include "mock_arduino.hpp"
+#include "../src/chess_engine.hpp"
+#include "../src/arena.hpp"
+#include <cstring>
+
+MockSerial Serial;
+
+// Desktop UCI front end: feeds stdin byte by byte through the same text
+// and binary frame handling the firmware uses in loop(). -memory prints the
+// same RAM report the firmware sends at boot.
+int main(int argc, char **argv){
+  initEngine();
+  if(argc>1 && strcmp(argv[1],"-memory")==0) reportMemory();
+  int c;
+  while(!quitRequested && (c=std::cin.get())!=EOF) protocolInput((uint8_t)c);
+  return 0;
+}
@@ -7,7 +7,7 @@ set GOARCH=amd64
 set CGO_ENABLED=0
 
 :: Build the executable
-go build -ldflags="-s -w" -o uci-bridge.exe main.go
+go build -ldflags="-s -w" -o uci-bridge.exe .
 
 if %ERRORLEVEL% EQU 0 (
     echo ✅ Build successful: uci-bridge.exe
@@ -0,0 +1,381 @@
+package main
+
+import (
+	"bytes"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"strconv"
+	"strings"
+	"time"
+)
+
+// Binary frame protocol shared with pi-pico-engine/src/protocol.hpp:
+//
+//	sync 0xA5, type, len lo, len hi, payload[len], xor of type/len/payload
+//
+// The firmware always accepts text lines as well, so anything without a
+// compact encoding is sent as a FRAME_TEXT frame.
+const (
+	frameSync       = 0xA5
+	frameMaxPayload = 256
+
+	frameText     = 0x01
+	framePosition = 0x02
+	frameMoves    = 0x03
+	frameGo       = 0x04
+	frameOutText  = 0x81
+	frameInfo     = 0x82
+	frameBestMove = 0x83
+
+	startFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+)
+
+func encodeFrame(typ byte, payload []byte) []byte {
+	out := make([]byte, 0, len(payload)+5)
+	out = append(out, frameSync, typ, byte(len(payload)), byte(len(payload)>>8))
+	check := typ ^ byte(len(payload)) ^ byte(len(payload)>>8)
+	for _, c := range payload {
+		check ^= c
+	}
+	out = append(out, payload...)
+	return append(out, check)
+}
+
+// encodeCommand frames one UCI command line. A command longer than
+// frameMaxPayload is sent as a plain text line, which the firmware accepts
+// in binary mode too.
+func encodeCommand(cmd string) []byte {
+	if len(cmd) > frameMaxPayload {
+		return []byte(cmd + "\n")
+	}
+	return encodeFrame(frameText, []byte(cmd))
+}
+
+// encodeMove packs a UCI move as from | to<<6 | promo<<12.
+func encodeMove(uci string) (uint16, error) {
+	if len(uci) < 4 || len(uci) > 5 ||
+		uci[0] < 'a' || uci[0] > 'h' || uci[1] < '1' || uci[1] > '8' ||
+		uci[2] < 'a' || uci[2] > 'h' || uci[3] < '1' || uci[3] > '8' {
+		return 0, fmt.Errorf("bad move %q", uci)
+	}
+	from := uint16(uci[1]-'1')*8 + uint16(uci[0]-'a')
+	to := uint16(uci[3]-'1')*8 + uint16(uci[2]-'a')
+	code := from | to<<6
+	if len(uci) == 5 {
+		promo := strings.IndexByte(" nbrq", uci[4])
+		if promo <= 0 {
+			return 0, fmt.Errorf("bad promotion %q", uci)
+		}
+		code |= uint16(promo) << 12
+	}
+	return code, nil
+}
+
+// decodeMove renders a move code; from == to is the UCI null move.
+func decodeMove(code uint16) string {
+	from, to, promo := code&63, (code>>6)&63, (code>>12)&7
+	if from == to {
+		return "0000"
+	}
+	s := []byte{'a' + byte(from%8), '1' + byte(from/8), 'a' + byte(to%8), '1' + byte(to/8)}
+	if promo != 0 {
+		s = append(s, " nbrq"[promo])
+	}
+	return string(s)
+}
+
+func put16(b []byte, v uint16) { b[0] = byte(v); b[1] = byte(v >> 8) }
+func put32(b []byte, v uint32) {
+	b[0] = byte(v)
+	b[1] = byte(v >> 8)
+	b[2] = byte(v >> 16)
+	b[3] = byte(v >> 24)
+}
+func get16(b []byte) uint16 { return uint16(b[0]) | uint16(b[1])<<8 }
+func get32(b []byte) uint32 {
+	return uint32(b[0]) | uint32(b[1])<<8 | uint32(b[2])<<16 | uint32(b[3])<<24
+}
+
+// encodeFEN builds a FRAME_POSITION payload: 12 bitboards (WP..BK), side,
+// castling rights, en passant square (64 = none), halfmove, fullmove.
+func encodeFEN(fen string) ([]byte, error) {
+	fields := strings.Fields(fen)
+	if len(fields) < 4 {
+		return nil, fmt.Errorf("short FEN %q", fen)
+	}
+	payload := make([]byte, 102)
+	rank, file := 7, 0
+	for _, c := range fields[0] {
+		switch {
+		case c == '/':
+			rank, file = rank-1, 0
+		case c >= '1' && c <= '8':
+			file += int(c - '0')
+		default:
+			p := strings.IndexRune("PNBRQKpnbrqk", c)
+			if p < 0 || rank < 0 || file > 7 {
+				return nil, fmt.Errorf("bad FEN placement %q", fields[0])
+			}
+			sq := uint(rank*8 + file)
+			bb := uint64(get32(payload[8*p:])) | uint64(get32(payload[8*p+4:]))<<32
+			bb |= 1 << sq
+			put32(payload[8*p:], uint32(bb))
+			put32(payload[8*p+4:], uint32(bb>>32))
+			file++
+		}
+	}
+	if fields[1] == "b" {
+		payload[96] = 1
+	}
+	for _, c := range fields[2] {
+		switch c {
+		case 'K':
+			payload[97] |= 1
+		case 'Q':
+			payload[97] |= 2
+		case 'k':
+			payload[97] |= 4
+		case 'q':
+			payload[97] |= 8
+		}
+	}
+	payload[98] = 64
+	if ep := fields[3]; len(ep) == 2 && ep[0] >= 'a' && ep[0] <= 'h' && ep[1] >= '1' && ep[1] <= '8' {
+		payload[98] = (ep[1]-'1')*8 + (ep[0] - 'a')
+	}
+	fullmove := 1
+	if len(fields) >= 6 {
+		if h, err := strconv.Atoi(fields[4]); err == nil && h >= 0 && h < 256 {
+			payload[99] = byte(h)
+		}
+		if f, err := strconv.Atoi(fields[5]); err == nil && f > 0 {
+			fullmove = f
+		}
+	}
+	put16(payload[100:], uint16(fullmove))
+	return payload, nil
+}
+
+// positionTracker remembers the last position sent so a command that only
+// appends moves to the same game goes out as a FRAME_MOVES delta.
+type positionTracker struct {
+	base  string
+	moves []string
+	valid bool
+}
+
+func (t *positionTracker) reset() { t.valid = false }
+
+// encode turns a "position ..." command into frames.
+func (t *positionTracker) encode(cmd string) ([][]byte, error) {
+	fields := strings.Fields(cmd)
+	if len(fields) < 2 || fields[0] != "position" {
+		return nil, fmt.Errorf("not a position command: %q", cmd)
+	}
+	base := startFEN
+	i := 2
+	if fields[1] == "fen" {
+		j := i
+		for j < len(fields) && fields[j] != "moves" {
+			j++
+		}
+		base = strings.Join(fields[i:j], " ")
+		i = j
+	} else if fields[1] != "startpos" {
+		return nil, fmt.Errorf("bad position command: %q", cmd)
+	}
+	var moves []string
+	if i < len(fields) && fields[i] == "moves" {
+		moves = fields[i+1:]
+	}
+
+	var frames [][]byte
+	newMoves := moves
+	if t.valid && base == t.base && len(moves) >= len(t.moves) && equalMoves(moves[:len(t.moves)], t.moves) {
+		newMoves = moves[len(t.moves):]
+	} else {
+		payload, err := encodeFEN(base)
+		if err != nil {
+			return nil, err
+		}
+		frames = append(frames, encodeFrame(framePosition, payload))
+	}
+	for len(newMoves) > 0 {
+		n := len(newMoves)
+		if n > (frameMaxPayload-1)/2 {
+			n = (frameMaxPayload - 1) / 2
+		}
+		payload := make([]byte, 1+2*n)
+		payload[0] = byte(n)
+		for k := 0; k < n; k++ {
+			code, err := encodeMove(newMoves[k])
+			if err != nil {
+				return nil, err
+			}
+			put16(payload[1+2*k:], code)
+		}
+		frames = append(frames, encodeFrame(frameMoves, payload))
+		newMoves = newMoves[n:]
+	}
+	t.base, t.moves, t.valid = base, append([]string(nil), moves...), true
+	return frames, nil
+}
+
+func equalMoves(a, b []string) bool {
+	for i := range a {
+		if a[i] != b[i] {
+			return false
+		}
+	}
+	return true
+}
+
+// encodeGo builds a FRAME_GO payload. ok is false for go commands that
+// have no compact form (searchmoves, infinite, ponder).
+func encodeGo(cmd string) (payload []byte, ok bool) {
+	fields := strings.Fields(cmd)
+	payload = make([]byte, 27)
+	offsets := map[string]int{"wtime": 0, "btime": 4, "winc": 8, "binc": 12, "movetime": 16, "nodes": 20}
+	for i := 1; i < len(fields); i++ {
+		key := fields[i]
+		if key == "searchmoves" || key == "infinite" || key == "ponder" || key == "mate" {
+			return nil, false
+		}
+		if i+1 >= len(fields) {
+			return nil, false
+		}
+		v, err := strconv.Atoi(fields[i+1])
+		if err != nil {
+			return nil, false
+		}
+		if v < 0 {
+			v = 0
+		}
+		i++
+		switch {
+		case key == "movestogo":
+			put16(payload[24:], uint16(v))
+		case key == "depth":
+			if v > 255 {
+				v = 255
+			}
+			payload[26] = byte(v)
+		default:
+			off, known := offsets[key]
+			if !known {
+				return nil, false
+			}
+			put32(payload[off:], uint32(v))
+		}
+	}
+	return payload, true
+}
+
+// decodeFrame renders an engine frame as the UCI text line it replaces.
+func decodeFrame(typ byte, p []byte) (string, error) {
+	switch typ {
+	case frameOutText:
+		return string(p), nil
+	case frameBestMove:
+		if len(p) < 2 {
+			return "", errors.New("short bestmove frame")
+		}
+		return "bestmove " + decodeMove(get16(p)), nil
+	case frameInfo:
+		if len(p) < 14 || len(p) < 14+2*int(p[13]) {
+			return "", errors.New("short info frame")
+		}
+		kind := "cp"
+		if p[2] != 0 {
+			kind = "mate"
+		}
+		var sb strings.Builder
+		fmt.Fprintf(&sb, "info depth %d multipv %d score %s %d nodes %d time %d pv",
+			p[0], p[1], kind, int16(get16(p[3:])), get32(p[5:]), get32(p[9:]))
+		for i := 0; i < int(p[13]); i++ {
+			sb.WriteString(" " + decodeMove(get16(p[14+2*i:])))
+		}
+		return sb.String(), nil
+	}
+	return "", fmt.Errorf("unknown frame type 0x%02x", typ)
+}
+
+// frameReader splits the engine's output into text lines and frames.
+// Frames that pass the checksum but cannot be decoded are reported to logf
+// (if set) and skipped.
+type frameReader struct {
+	r    io.Reader
+	buf  []byte
+	logf func(format string, args ...interface{})
+}
+
+// next returns the next text line or decoded frame; framed reports which.
+// An empty line with a nil error means the deadline passed.
+func (fr *frameReader) next(deadline time.Time) (line string, framed bool, err error) {
+	chunk := make([]byte, 512)
+	for {
+		for len(fr.buf) > 0 {
+			if fr.buf[0] != frameSync {
+				// Text never contains frameSync, so bytes before one that is not
+				// preceded by a newline are the tail of a corrupt frame.
+				nl := bytes.IndexByte(fr.buf, '\n')
+				if sync := bytes.IndexByte(fr.buf, frameSync); sync >= 0 && (nl < 0 || sync < nl) {
+					fr.buf = fr.buf[sync:]
+					continue
+				}
+				if nl < 0 {
+					break
+				}
+				line = strings.TrimRight(string(fr.buf[:nl]), "\r")
+				fr.buf = fr.buf[nl+1:]
+				return line, false, nil
+			}
+			if len(fr.buf) < 4 {
+				break
+			}
+			n := int(get16(fr.buf[2:]))
+			if n > frameMaxPayload {
+				fr.buf = fr.buf[1:]
+				continue
+			}
+			if len(fr.buf) < 5+n {
+				break
+			}
+			check := byte(0)
+			for _, c := range fr.buf[1 : 4+n] {
+				check ^= c
+			}
+			if check != fr.buf[4+n] {
+				fr.buf = fr.buf[1:]
+				continue
+			}
+			typ, payload := fr.buf[1], fr.buf[4:4+n]
+			fr.buf = fr.buf[5+n:]
+			line, err := decodeFrame(typ, payload)
+			if err != nil {
+				if fr.logf != nil {
+					fr.logf("Skipping frame: %v", err)
+				}
+				continue
+			}
+			return line, true, nil
+		}
+
+		if time.Now().After(deadline) {
+			return "", false, nil
+		}
+		if f, ok := fr.r.(*os.File); ok {
+			f.SetReadDeadline(deadline)
+		}
+		n, err := fr.r.Read(chunk)
+		fr.buf = append(fr.buf, chunk[:n]...)
+		if err != nil {
+			if errors.Is(err, os.ErrDeadlineExceeded) {
+				return "", false, nil
+			}
+			return "", false, err
+		}
+	}
+}
@@ -0,0 +1,115 @@
+package main
+
+import (
+	"bytes"
+	"strings"
+	"testing"
+	"time"
+)
+
+func TestMoveCodeRoundTrip(t *testing.T) {
+	for _, mv := range []string{"e2e4", "a7a8q", "h1a8", "e1g1", "b2b1n"} {
+		code, err := encodeMove(mv)
+		if err != nil {
+			t.Fatalf("encodeMove(%q): %v", mv, err)
+		}
+		if got := decodeMove(code); got != mv {
+			t.Errorf("decodeMove(encodeMove(%q)) = %q", mv, got)
+		}
+	}
+	if _, err := encodeMove("e9e4"); err == nil {
+		t.Error("expected error for off-board move")
+	}
+	if got := decodeMove(0); got != "0000" {
+		t.Errorf("decodeMove(0) = %q, want null move", got)
+	}
+}
+
+func TestEncodeCommand(t *testing.T) {
+	if f := encodeCommand("isready"); f[0] != frameSync || f[1] != frameText {
+		t.Errorf("short command not framed: %v", f)
+	}
+	long := "go depth 1 searchmoves" + strings.Repeat(" a2a3", 60)
+	if got := string(encodeCommand(long)); got != long+"\n" {
+		t.Errorf("long command not sent as a text line: %q", got)
+	}
+}
+
+func TestEncodeStartFEN(t *testing.T) {
+	p, err := encodeFEN(startFEN)
+	if err != nil {
+		t.Fatal(err)
+	}
+	bb := func(piece int) uint64 { return uint64(get32(p[8*piece:])) | uint64(get32(p[8*piece+4:]))<<32 }
+	if bb(0) != 0xFF00 {
+		t.Errorf("white pawns = %#x", bb(0))
+	}
+	if bb(11) != 1<<60 {
+		t.Errorf("black king = %#x", bb(11))
+	}
+	if p[96] != 0 || p[97] != 15 || p[98] != 64 || get16(p[100:]) != 1 {
+		t.Errorf("state = side %d castle %d ep %d fullmove %d", p[96], p[97], p[98], get16(p[100:]))
+	}
+}
+
+func TestPositionDelta(t *testing.T) {
+	var tr positionTracker
+	frames, err := tr.encode("position startpos moves e2e4")
+	if err != nil || len(frames) != 2 || frames[0][1] != framePosition || frames[1][1] != frameMoves {
+		t.Fatalf("first position: %d frames, err %v", len(frames), err)
+	}
+	frames, err = tr.encode("position startpos moves e2e4 e7e5 g1f3")
+	if err != nil || len(frames) != 1 || frames[0][1] != frameMoves || frames[0][4] != 2 {
+		t.Fatalf("delta: %v, err %v", frames, err)
+	}
+	frames, err = tr.encode("position startpos moves d2d4")
+	if err != nil || len(frames) != 2 || frames[0][1] != framePosition {
+		t.Fatalf("new game: %d frames, err %v", len(frames), err)
+	}
+}
+
+func TestEncodeGo(t *testing.T) {
+	p, ok := encodeGo("go wtime 60000 btime 59000 movestogo 20 depth 6")
+	if !ok || get32(p[0:]) != 60000 || get32(p[4:]) != 59000 || get16(p[24:]) != 20 || p[26] != 6 {
+		t.Fatalf("encodeGo: ok %v payload %v", ok, p)
+	}
+	if _, ok := encodeGo("go depth 4 searchmoves e2e4"); ok {
+		t.Error("searchmoves should fall back to text")
+	}
+}
+
+func TestFrameReader(t *testing.T) {
+	var stream bytes.Buffer
+	stream.WriteString("id name PicoChess\n")
+	stream.Write(encodeFrame(frameOutText, []byte("readyok")))
+	bad := encodeFrame(frameOutText, []byte("garbage"))
+	bad[len(bad)-1] ^= 0xFF
+	stream.Write(bad)
+	stream.Write(encodeFrame(0x90, []byte{1, 2, 3}))
+	info := []byte{5, 1, 0, 0xCE, 0xFF, 100, 0, 0, 0, 7, 0, 0, 0, 1, 0, 0}
+	code, _ := encodeMove("e2e4")
+	put16(info[14:], code)
+	stream.Write(encodeFrame(frameInfo, info))
+	stream.Write(encodeFrame(frameBestMove, info[14:16]))
+
+	skipped := 0
+	fr := &frameReader{r: &stream, logf: func(string, ...interface{}) { skipped++ }}
+	want := []struct {
+		line   string
+		framed bool
+	}{
+		{"id name PicoChess", false},
+		{"readyok", true},
+		{"info depth 5 multipv 1 score cp -50 nodes 100 time 7 pv e2e4", true},
+		{"bestmove e2e4", true},
+	}
+	for _, w := range want {
+		line, framed, err := fr.next(time.Now().Add(time.Second))
+		if err != nil || line != w.line || framed != w.framed {
+			t.Fatalf("got %q framed=%v err=%v, want %q framed=%v", line, framed, err, w.line, w.framed)
+		}
+	}
+	if skipped != 1 {
+		t.Errorf("%d undecodable frames logged, want 1", skipped)
+	}
+}
@@ -35,6 +35,12 @@ type UCIBridge struct {
 	engineReady  bool
 	engineName   string
 	engineAuthor string
+
+	// Binary frame mode (see frame.go), negotiated after uci
+	binaryRequested bool
+	binaryMode      bool
+	frames          *frameReader
+	positions       positionTracker
 }
 
 func NewUCIBridge() *UCIBridge {
@@ -110,6 +116,10 @@ func (b *UCIBridge) loadConfig(filename string) {
 				b.debugMode = strings.ToLower(value) == "true" || value == "1"
 				b.debugLog("Config: Debug mode set to %v", b.debugMode)
 
+			case "binary", "binary_frames":
+				b.binaryRequested = strings.ToLower(value) == "true" || value == "1"
+				b.debugLog("Config: Binary frames set to %v", b.binaryRequested)
+
 			case "logfile", "log_file":
 				if value != "" {
 					if logFile, err := os.OpenFile(value, os.O_CREATE|os.O_WRONLY|os.O_APPEND, 0666); err == nil {
@@ -174,6 +184,8 @@ func (b *UCIBridge) parseArgs() {
 			}
 		case "-debug", "-d":
 			b.debugMode = true
+		case "-binary":
+			b.binaryRequested = true
 		case "-log", "-l":
 			if i+1 < len(args) {
 				if logFile, err := os.OpenFile(args[i+1], os.O_CREATE|os.O_WRONLY|os.O_APPEND, 0666); err == nil {
@@ -231,6 +243,9 @@ debug=true
 # Log file for debug output
 logfile=bridge.log
 
+# Binary frames between bridge and Pico (falls back to text if unsupported)
+binary=false
+
 # ==============================================
 # Examples for different setups:
 # ==============================================
@@ -261,6 +276,7 @@ func (b *UCIBridge) printUsage() {
 	fmt.Println("  -timeout, -t <sec>   Timeout in seconds (default: 3)")
 	fmt.Println("  -debug, -d           Enable debug mode")
 	fmt.Println("  -log, -l <file>      Log to file")
+	fmt.Println("  -binary              Use binary frames to the Pico if supported")
 	fmt.Println("  -create-config       Create default config file")
 	fmt.Println("  -help, -h            Show this help")
 	fmt.Println("")
@@ -339,6 +355,10 @@ func (b *UCIBridge) sendToPico(command string) error {
 		return nil
 	}
 
+	if b.binaryMode {
+		return b.sendFramesToPico(command)
+	}
+
 	b.debugLog("Bridge -> Pico: %s", command)
 
 	// Send command with newline
@@ -350,6 +370,82 @@ func (b *UCIBridge) sendToPico(command string) error {
 	return nil
 }
 
+// sendFramesToPico sends a command in binary mode: positions as a full
+// position or a move-list delta, go as a compact record, the rest as text
+// frames (plain lines when longer than frameMaxPayload).
+func (b *UCIBridge) sendFramesToPico(command string) error {
+	var frames [][]byte
+	switch {
+	case strings.HasPrefix(command, "position "):
+		var err error
+		if frames, err = b.positions.encode(command); err != nil {
+			b.debugLog("Position not encodable (%v), sending as text", err)
+			b.positions.reset()
+			frames = [][]byte{encodeCommand(command)}
+		}
+	case strings.HasPrefix(command, "go"):
+		if payload, ok := encodeGo(command); ok {
+			frames = [][]byte{encodeFrame(frameGo, payload)}
+		} else {
+			frames = [][]byte{encodeCommand(command)}
+		}
+	default:
+		if command == "ucinewgame" {
+			b.positions.reset()
+		}
+		frames = [][]byte{encodeCommand(command)}
+	}
+
+	total := 0
+	for _, f := range frames {
+		if _, err := b.port.Write(f); err != nil {
+			return fmt.Errorf("failed to write to serial port: %v", err)
+		}
+		total += len(f)
+	}
+	b.debugLog("Bridge -> Pico [%d frames, %d bytes]: %s", len(frames), total, command)
+	return nil
+}
+
+// negotiateBinary asks the Pico to switch to binary frames. A framed
+// readyok confirms the switch; a text readyok means the firmware does not
+// support it and the bridge stays on text.
+func (b *UCIBridge) negotiateBinary() {
+	b.debugLog("Requesting binary frames")
+	if err := b.sendToPico("setoption name BinaryFrames value true"); err != nil {
+		return
+	}
+	if err := b.sendToPico("isready"); err != nil {
+		return
+	}
+	b.port.SetReadTimeout(100 * time.Millisecond)
+	b.frames = &frameReader{r: b.port, logf: b.debugLog}
+	deadline := time.Now().Add(2 * time.Second)
+	for time.Now().Before(deadline) {
+		line, framed, err := b.frames.next(deadline)
+		if err != nil {
+			b.debugLog("Binary negotiation error: %v", err)
+			continue
+		}
+		if line == READY_OK {
+			b.binaryMode = framed
+			b.positions.reset()
+			b.debugLog("Binary frames active: %v", framed)
+			return
+		}
+	}
+	b.debugLog("No readyok during binary negotiation - staying on text")
+}
+
+// settle pauses to let the Pico catch up between text commands. Frames are
+// delimited and checksummed and readFromPico blocks until one arrives, so
+// binary mode skips these pauses.
+func (b *UCIBridge) settle(d time.Duration) {
+	if !b.binaryMode {
+		time.Sleep(d)
+	}
+}
+
 func (b *UCIBridge) readFromPico() (string, error) {
 	if b.port == nil {
 		return "", fmt.Errorf("serial port not connected")
@@ -358,6 +454,17 @@ func (b *UCIBridge) readFromPico() (string, error) {
 	// Set shorter read timeout for individual reads
 	b.port.SetReadTimeout(100 * time.Millisecond)
 
+	if b.binaryMode {
+		line, _, err := b.frames.next(time.Now().Add(2 * time.Second))
+		if err != nil {
+			return "", fmt.Errorf("frame error: %v", err)
+		}
+		if line != "" {
+			b.debugLog("Pico -> Bridge [frame]: %s", line)
+		}
+		return line, nil
+	}
+
 	buffer := make([]byte, 1)
 	var response strings.Builder
 	totalTimeout := 2 * time.Second
@@ -414,6 +521,10 @@ func (b *UCIBridge) handleUCICommand(command string) error {
 		// CRITICAL: Shredder expects immediate UCI response!
 		b.debugLog("=== UCI INITIALIZATION START ===")
 
+		// uci always goes out as text and resets the Pico to text output
+		b.binaryMode = false
+		binarySupported := false
+
 		// Send UCI command to Pico
 		err := b.sendToPico(command)
 		if err != nil {
@@ -437,7 +548,9 @@ func (b *UCIBridge) handleUCICommand(command string) error {
 					b.debugLog("UCI response from Pico: %s", response)
 
 					// Forward response to GUI (except uciok, we handle that ourselves)
-					if response != UCI_OK && !strings.HasPrefix(response, "id ") {
+					if strings.HasPrefix(response, "option name BinaryFrames") {
+						binarySupported = true
+					} else if response != UCI_OK && !strings.HasPrefix(response, "id ") {
 						b.sendToGUI(response)
 					}
 
@@ -454,6 +567,10 @@ func (b *UCIBridge) handleUCICommand(command string) error {
 			if !uciComplete {
 				b.debugLog("UCI sequence incomplete or timeout - proceeding anyway")
 			}
+
+			if b.binaryRequested && binarySupported {
+				b.negotiateBinary()
+			}
 		}
 
 		// ALWAYS send standard UCI response to GUI
@@ -470,13 +587,13 @@ func (b *UCIBridge) handleUCICommand(command string) error {
 		b.debugLog("=== UCI INITIALIZATION COMPLETE ===")
 
 		// IMPORTANT: Give Pico time to finish before next command
-		time.Sleep(200 * time.Millisecond)
+		b.settle(200 * time.Millisecond)
 
 	case command == "isready":
 		b.debugLog("=== ISREADY CHECK ===")
 
 		// Give Pi Pico time to finish any previous command
-		time.Sleep(100 * time.Millisecond)
+		b.settle(100 * time.Millisecond)
 
 		// Send isready and wait for proper response
 		err := b.sendToPico(command)
@@ -506,7 +623,7 @@ func (b *UCIBridge) handleUCICommand(command string) error {
 					}
 				}
 
-				time.Sleep(50 * time.Millisecond)
+				b.settle(50 * time.Millisecond)
 			}
 		}
 
@@ -515,7 +632,7 @@ func (b *UCIBridge) handleUCICommand(command string) error {
 		b.debugLog("=== ISREADY COMPLETE ===")
 
 		// Give Pi Pico time before next command
-		time.Sleep(100 * time.Millisecond)
+		b.settle(100 * time.Millisecond)
 
 	case command == "quit":
 		b.debugLog("=== QUIT COMMAND ===")
@@ -590,7 +707,7 @@ func (b *UCIBridge) handleUCICommand(command string) error {
 					}
 				}
 
-				time.Sleep(10 * time.Millisecond)
+				b.settle(10 * time.Millisecond)
 			}
 		}()
 
@@ -610,7 +727,7 @@ func (b *UCIBridge) handleUCICommand(command string) error {
 		b.debugLog("=== OTHER COMMAND: %s ===", command)
 
 		// Give Pi Pico time to finish previous command
-		time.Sleep(50 * time.Millisecond)
+		b.settle(50 * time.Millisecond)
 
 		err := b.sendToPico(command)
 		if err != nil {
@@ -623,7 +740,7 @@ func (b *UCIBridge) handleUCICommand(command string) error {
 			strings.HasPrefix(command, "ucinewgame") ||
 			strings.HasPrefix(command, "setoption") {
 			b.debugLog("Command sent, no response expected")
-			time.Sleep(50 * time.Millisecond) // Give Pi Pico time to process
+			b.settle(50 * time.Millisecond) // Give Pi Pico time to process
 			return nil
 		}
 
@@ -639,11 +756,11 @@ func (b *UCIBridge) handleUCICommand(command string) error {
 				b.sendToGUI(response)
 				break
 			}
-			time.Sleep(50 * time.Millisecond)
+			b.settle(50 * time.Millisecond)
 		}
 
 		// Small delay before next command
-		time.Sleep(50 * time.Millisecond)
+		b.settle(50 * time.Millisecond)
 	}
 
 	return nil
@@ -0,0 +1,300 @@
+//go:build linux
+
+package main
+
+import (
+	"bufio"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"os/exec"
+	"strings"
+	"sync/atomic"
+	"syscall"
+	"testing"
+	"time"
+	"unsafe"
+
+	"go.bug.st/serial"
+)
+
+// Loopback tests against the desktop build of the firmware
+// (pi-pico-engine/tools, "make engine_a") over a pseudo-terminal, which
+// behaves like the Pico's USB-CDC port. The engine is built on demand;
+// set PICOCHESS_ENGINE to use another binary.
+
+func ioctl(fd, req, arg uintptr) error {
+	if _, _, e := syscall.Syscall(syscall.SYS_IOCTL, fd, req, arg); e != 0 {
+		return e
+	}
+	return nil
+}
+
+func openPTY() (master, slave *os.File, err error) {
+	master, err = os.OpenFile("/dev/ptmx", os.O_RDWR|syscall.O_NOCTTY, 0)
+	if err != nil {
+		return nil, nil, err
+	}
+	var unlock, n int32
+	if err = ioctl(master.Fd(), syscall.TIOCSPTLCK, uintptr(unsafe.Pointer(&unlock))); err == nil {
+		err = ioctl(master.Fd(), syscall.TIOCGPTN, uintptr(unsafe.Pointer(&n)))
+	}
+	if err == nil {
+		slave, err = os.OpenFile(fmt.Sprintf("/dev/pts/%d", n), os.O_RDWR|syscall.O_NOCTTY, 0)
+	}
+	if err == nil {
+		var tio syscall.Termios
+		if err = ioctl(slave.Fd(), syscall.TCGETS, uintptr(unsafe.Pointer(&tio))); err == nil {
+			// raw mode, like cfmakeraw()
+			tio.Iflag &^= syscall.IGNBRK | syscall.BRKINT | syscall.PARMRK | syscall.ISTRIP |
+				syscall.INLCR | syscall.IGNCR | syscall.ICRNL | syscall.IXON
+			tio.Oflag &^= syscall.OPOST
+			tio.Lflag &^= syscall.ECHO | syscall.ECHONL | syscall.ICANON | syscall.ISIG | syscall.IEXTEN
+			tio.Cflag &^= syscall.CSIZE | syscall.PARENB
+			tio.Cflag |= syscall.CS8
+			tio.Cc[syscall.VMIN], tio.Cc[syscall.VTIME] = 1, 0
+			err = ioctl(slave.Fd(), syscall.TCSETS, uintptr(unsafe.Pointer(&tio)))
+		}
+	}
+	if err != nil {
+		master.Close()
+		if slave != nil {
+			slave.Close()
+		}
+		return nil, nil, err
+	}
+	return master, slave, nil
+}
+
+// engineBinary returns the desktop engine, building it first unless
+// PICOCHESS_ENGINE names one.
+func engineBinary(t *testing.T) string {
+	if engine := os.Getenv("PICOCHESS_ENGINE"); engine != "" {
+		if _, err := os.Stat(engine); err != nil {
+			t.Fatalf("PICOCHESS_ENGINE: %v", err)
+		}
+		return engine
+	}
+	out, err := exec.Command("make", "-C", "../pi-pico-engine/tools", "engine_a").CombinedOutput()
+	if err != nil {
+		t.Fatalf("building the desktop engine: %v\n%s", err, out)
+	}
+	return "../pi-pico-engine/tools/engine_a"
+}
+
+// startEngine runs the engine on a pseudo-terminal and returns the host end.
+func startEngine(t *testing.T) *os.File {
+	engine := engineBinary(t)
+	master, slave, err := openPTY()
+	if err != nil {
+		t.Skipf("no pseudo-terminal: %v", err)
+	}
+	cmd := exec.Command(engine)
+	cmd.Stdin, cmd.Stdout = slave, slave
+	if err := cmd.Start(); err != nil {
+		t.Fatal(err)
+	}
+	slave.Close()
+	t.Cleanup(func() {
+		cmd.Process.Kill()
+		cmd.Wait()
+		master.Close()
+	})
+	return master
+}
+
+// ptyPort gives the bridge a pseudo-terminal as its serial port. Like the
+// serial driver, a read that times out returns no bytes and no error.
+type ptyPort struct {
+	serial.Port // not used by the bridge
+	f           *os.File
+	timeout     time.Duration
+}
+
+func (p *ptyPort) Read(b []byte) (int, error) {
+	if p.timeout > 0 {
+		p.f.SetReadDeadline(time.Now().Add(p.timeout))
+	}
+	n, err := p.f.Read(b)
+	if errors.Is(err, os.ErrDeadlineExceeded) {
+		return n, nil
+	}
+	return n, err
+}
+
+func (p *ptyPort) Write(b []byte) (int, error)          { return p.f.Write(b) }
+func (p *ptyPort) SetReadTimeout(d time.Duration) error { p.timeout = d; return nil }
+func (p *ptyPort) Close() error                         { return p.f.Close() }
+
+// runBridge feeds GUI commands to a bridge on port and returns what it
+// printed for the GUI.
+func runBridge(t *testing.T, b *UCIBridge, commands ...string) []string {
+	r, w, err := os.Pipe()
+	if err != nil {
+		t.Fatal(err)
+	}
+	stdout := os.Stdout
+	os.Stdout = w
+	done := make(chan string)
+	go func() {
+		out, _ := io.ReadAll(r)
+		done <- string(out)
+	}()
+	for _, c := range commands {
+		b.handleUCICommand(c)
+	}
+	os.Stdout = stdout
+	w.Close()
+	return strings.Split(strings.TrimSpace(<-done), "\n")
+}
+
+func lastWithPrefix(lines []string, prefix string) string {
+	for i := len(lines) - 1; i >= 0; i-- {
+		if strings.HasPrefix(lines[i], prefix) {
+			return lines[i]
+		}
+	}
+	return ""
+}
+
+func TestPTYLoopback(t *testing.T) {
+	master := startEngine(t)
+	fr := &frameReader{r: master}
+	send := func(b []byte) {
+		if _, err := master.Write(b); err != nil {
+			t.Fatal(err)
+		}
+	}
+	expect := func(prefix string, framed bool) string {
+		deadline := time.Now().Add(5 * time.Second)
+		for {
+			line, f, err := fr.next(deadline)
+			if err != nil {
+				t.Fatal(err)
+			}
+			if line == "" && time.Now().After(deadline) {
+				t.Fatalf("timeout waiting for %q", prefix)
+			}
+			if strings.HasPrefix(line, prefix) {
+				if f != framed {
+					t.Fatalf("%q: framed=%v, want %v", line, f, framed)
+				}
+				return line
+			}
+		}
+	}
+
+	// Text handshake, then switch to frames.
+	send([]byte("uci\n"))
+	expect("option name BinaryFrames", false)
+	expect("uciok", false)
+	send([]byte("setoption name BinaryFrames value true\nisready\n"))
+	expect("readyok", true)
+
+	var tr positionTracker
+	frames, err := tr.encode("position startpos moves e2e4 e7e5")
+	if err != nil {
+		t.Fatal(err)
+	}
+	for _, f := range frames {
+		send(f)
+	}
+	frames, _ = tr.encode("position startpos moves e2e4 e7e5 g1f3 b8c6")
+	for _, f := range frames {
+		send(f)
+	}
+	goPayload, _ := encodeGo("go depth 3")
+	send(encodeFrame(frameGo, goPayload))
+	info := expect("info depth 3", true)
+	best := expect("bestmove", true)
+	mv := strings.Fields(best)[1]
+	if !strings.Contains(info, " pv "+mv) {
+		t.Errorf("bestmove %s does not start the pv of %q", mv, info)
+	}
+
+	// Text commands still work in binary mode and uci drops back to text.
+	send([]byte("isready\n"))
+	expect("readyok", true)
+	send([]byte("uci\n"))
+	expect("uciok", false)
+	send([]byte("position fen 6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1\ngo depth 2\n"))
+	if best := expect("bestmove", false); best != "bestmove a1a8" {
+		t.Errorf("text fallback: %q", best)
+	}
+}
+
+// The bridge end to end: negotiation, framed positions and go, framed
+// replies, and a command too long for a frame sent as a text line.
+func TestBridgeLoopback(t *testing.T) {
+	b := &UCIBridge{port: &ptyPort{f: startEngine(t)}, binaryRequested: true, engineName: "PicoChess", engineAuthor: "test"}
+	out := runBridge(t, b, "uci", "isready")
+	if !b.binaryMode {
+		t.Fatalf("binary frames not negotiated: %q", out)
+	}
+	if lastWithPrefix(out, "uciok") == "" || lastWithPrefix(out, "readyok") == "" {
+		t.Fatalf("handshake: %q", out)
+	}
+
+	out = runBridge(t, b, "position startpos moves e2e4 e7e5", "position startpos moves e2e4 e7e5 g1f3 b8c6", "go depth 3")
+	info, best := lastWithPrefix(out, "info depth 3"), lastWithPrefix(out, "bestmove ")
+	if info == "" || best == "" || !strings.Contains(info, " pv "+strings.Fields(best)[1]) {
+		t.Fatalf("framed search: %q", out)
+	}
+
+	long := "go depth 1 searchmoves" + strings.Repeat(" a2a3", 60)
+	out = runBridge(t, b, long)
+	if best := lastWithPrefix(out, "bestmove "); best != "bestmove a2a3" {
+		t.Errorf("long command: %q", out)
+	}
+	if !b.binaryMode {
+		t.Error("bridge left binary mode")
+	}
+}
+
+// fakeOldPico answers on f like firmware without binary frames. With
+// advertise it still lists the BinaryFrames option but ignores the switch.
+// Any frame it receives sets framed.
+func fakeOldPico(f *os.File, advertise bool, framed *atomic.Bool) {
+	sc := bufio.NewScanner(f)
+	for sc.Scan() {
+		line := sc.Text()
+		if strings.IndexByte(line, frameSync) >= 0 {
+			framed.Store(true)
+		}
+		switch {
+		case line == "uci":
+			reply := "id name PicoChess Bitboard\n"
+			if advertise {
+				reply += "option name BinaryFrames type check default false\n"
+			}
+			f.WriteString(reply + "uciok\n")
+		case line == "isready":
+			f.WriteString("readyok\n")
+		case strings.HasPrefix(line, "go"):
+			f.WriteString("info depth 1 score cp 20 pv e2e4\nbestmove e2e4\n")
+		}
+	}
+}
+
+func TestBridgeTextFallback(t *testing.T) {
+	for _, advertise := range []bool{false, true} {
+		master, slave, err := openPTY()
+		if err != nil {
+			t.Skipf("no pseudo-terminal: %v", err)
+		}
+		var framed atomic.Bool
+		go fakeOldPico(slave, advertise, &framed)
+
+		b := &UCIBridge{port: &ptyPort{f: master}, binaryRequested: true, engineName: "PicoChess", engineAuthor: "test"}
+		out := runBridge(t, b, "uci", "isready", "position startpos", "go depth 2")
+		if b.binaryMode || framed.Load() {
+			t.Errorf("advertise=%v: binary mode %v, frames sent %v", advertise, b.binaryMode, framed.Load())
+		}
+		if lastWithPrefix(out, "readyok") == "" || lastWithPrefix(out, "bestmove ") != "bestmove e2e4" {
+			t.Errorf("advertise=%v: %q", advertise, out)
+		}
+		master.Close()
+		slave.Close()
+	}
+}